@@ -0,0 +1,308 @@
+/**
+ * @file arena.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief bump arena for short lived per-router allocations and memory statistics
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "stddef.h"
+#include "sys/resource.h"
+
+#include "largemem.h"
+
+#define ARENA_ALIGN 16
+#define ARENA_MIN_BLOCK (1 << 20)
+
+/**
+ * @brief structure representing a block of arena memory
+ *
+ * @param next previously filled block
+ * @param size usable bytes of the block
+ * @param used bytes handed out from the block
+ */
+struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+};
+
+/**
+ * @brief structure representing a bump arena, everything is released at once by arena_reset
+ *
+ * @param head block currently being filled
+ * @param allocations number of allocations served
+ * @param blocks number of blocks requested from the system
+ * @param bytes bytes handed out since the last reset
+ * @param peak highest number of bytes handed out between two resets
+ */
+struct arena {
+    struct arena_block *head;
+    long allocations;
+    long blocks;
+    size_t bytes;
+    size_t peak;
+};
+
+/**
+ * @brief function allocating a new arena block
+ *
+ * @param size usable bytes of the block
+ * @return struct arena_block* pointer to the block
+ */
+struct arena_block *arena_new_block(size_t size)
+{
+    struct arena_block *block = (struct arena_block *)malloc(sizeof(struct arena_block) + ARENA_ALIGN + size);
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+/**
+ * @brief function initializing an arena
+ *
+ * @param size initial size of the arena in bytes
+ * @return struct arena* pointer to the initialized arena
+ */
+struct arena *init_arena(size_t size)
+{
+    struct arena *A = (struct arena *)malloc(sizeof(struct arena));
+
+    A->head = arena_new_block(size < ARENA_MIN_BLOCK ? ARENA_MIN_BLOCK : size);
+    A->allocations = 0;
+    A->blocks = 1;
+    A->bytes = 0;
+    A->peak = 0;
+
+    return A;
+}
+
+/**
+ * @brief function allocating memory from the arena
+ *
+ * @param A pointer to the arena
+ * @param bytes number of bytes
+ * @return void* pointer to the memory, valid until the next arena_reset
+ */
+void *arena_alloc(struct arena *A, size_t bytes)
+{
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    struct arena_block *block = A->head;
+
+    if (block->used + bytes > block->size)
+    {
+        size_t size = 2 * block->size;
+        if (size < bytes)
+            size = bytes;
+
+        block = arena_new_block(size);
+        block->next = A->head;
+        A->head = block;
+        A->blocks++;
+    }
+
+    // Block data starts after the header, rounded up to the alignment
+    char *data = (char *)(((size_t)(block + 1) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1));
+    void *ptr = data + block->used;
+
+    block->used += bytes;
+    A->bytes += bytes;
+    A->allocations++;
+
+    if (A->bytes > A->peak)
+        A->peak = A->bytes;
+
+    return ptr;
+}
+
+/**
+ * @brief function releasing everything allocated from the arena
+ * @details If the arena had to grow, its blocks are merged into one big enough for the next batch
+ *
+ * @param A pointer to the arena
+ */
+void arena_reset(struct arena *A)
+{
+    if (A->head->next != NULL)
+    {
+        size_t total = 0;
+        struct arena_block *block = A->head;
+
+        while (block != NULL)
+        {
+            struct arena_block *next = block->next;
+            total += block->size;
+            free(block);
+            block = next;
+        }
+
+        A->head = arena_new_block(total);
+        A->blocks++;
+    }
+
+    A->head->used = 0;
+    A->bytes = 0;
+}
+
+/**
+ * @brief function freeing the arena and all its memory
+ *
+ * @param A pointer to the arena
+ */
+void free_arena(struct arena *A)
+{
+    if (A == NULL)
+        return;
+
+    struct arena_block *block = A->head;
+    while (block != NULL)
+    {
+        struct arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(A);
+}
+
+/**
+ * @brief function allocating from the arena, or from the heap if there is no arena
+ *
+ * @param A pointer to the arena, may be NULL
+ * @param bytes number of bytes
+ * @return void* pointer to the memory
+ */
+void *scratch_alloc(struct arena *A, size_t bytes)
+{
+    return A != NULL ? arena_alloc(A, bytes) : malloc(bytes);
+}
+
+/*
+
+With -DALLOC_STATS the program is linked with -Wl,--wrap for the allocation
+functions, so every call made by our code goes through the counters below
+(allocations done inside MPI or libc are not counted).
+
+*/
+
+#ifdef ALLOC_STATS
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static long alloc_stats_calls = 0;
+static long alloc_stats_bytes = 0;
+
+void *__wrap_malloc(size_t size)
+{
+    __atomic_add_fetch(&alloc_stats_calls, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_stats_bytes, (long)size, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    __atomic_add_fetch(&alloc_stats_calls, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_stats_bytes, (long)(count * size), __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    __atomic_add_fetch(&alloc_stats_calls, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_stats_bytes, (long)size, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    __real_free(ptr);
+}
+
+#endif
+
+/**
+ * @brief function printing heap, arena, peak RSS, huge page and TLB statistics of all processes on node 0
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param A pointer to the arena of the calling process, may be NULL
+ * @param rank rank of the calling process
+ */
+void report_memory(struct arena *A, int rank)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    long calls = -1;
+    long bytes = -1;
+
+#ifdef ALLOC_STATS
+    calls = __atomic_load_n(&alloc_stats_calls, __ATOMIC_RELAXED);
+    bytes = __atomic_load_n(&alloc_stats_bytes, __ATOMIC_RELAXED);
+#endif
+
+    long local[5] = {calls, bytes, A ? A->allocations : 0, A ? A->blocks : 0, usage.ru_maxrss};
+    long total[5];
+    long peaks[2] = {A ? (long)A->peak : 0, usage.ru_maxrss};
+    long peak_max[2];
+
+    MPI_Reduce(local, total, 5, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(peaks, peak_max, 2, MPI_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    long tlb_misses = large_read_counter(large_memory.tlb_fd);
+    long remote_loads = large_read_counter(large_memory.remote_fd);
+    long huge_kb = large_huge_kb();
+    long large_local[6] = {large_memory.arrays, large_memory.bytes, huge_kb > 0 ? huge_kb : 0, large_memory.failed,
+                           tlb_misses > 0 ? tlb_misses : 0, remote_loads > 0 ? remote_loads : 0};
+    long large_total[6];
+    int available[2] = {tlb_misses >= 0, remote_loads >= 0};
+    int counted[2];
+
+    MPI_Reduce(large_local, large_total, 6, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(available, counted, 2, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank != 0)
+        return;
+
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (calls >= 0)
+        printf("Memory: %li heap allocations, %li bytes requested\n", total[0], total[1]);
+    else
+        printf("Memory: heap allocations not counted (build with ALLOC_STATS)\n");
+
+    if (A != NULL)
+        printf("Memory: %li arena allocations served by %li blocks, at most %li bytes per batch\n", total[2], total[3], peak_max[0]);
+
+    printf("Memory: peak RSS %li kB max, %li kB average per process\n", peak_max[1], total[4] / size);
+
+    if (large_memory.huge || large_memory.placement != LARGE_FIRST_TOUCH)
+        printf("Memory: %li large arrays (%li MB) advised, %li kB in huge pages, %li advices refused\n",
+               large_total[0], large_total[1] >> 20, large_total[2], large_total[3]);
+
+    if (counted[0] == size)
+        printf("Memory: %li dTLB load misses\n", large_total[4]);
+    else
+        printf("Memory: dTLB load misses not counted (perf_event_open not available)\n");
+
+    if (counted[1] == size)
+        printf("Memory: %li loads from a remote NUMA node\n", large_total[5]);
+    else
+        printf("Memory: remote NUMA loads not counted (perf_event_open not available)\n");
+}
+
+#endif
@@ -12,6 +12,7 @@
 #ifndef BELLFORD_H
 #define BELLFORD_H
 
+#include "arena.h"
 #include "graph.h"
 #include "stdlib.h"
 #include "stdio.h"
@@ -33,23 +34,30 @@ struct bellman_results {
 };
 
 /**
- * @brief function implementing the Bellman-Ford algorithm
- * 
- * @param G pointer to the graph
+ * @brief structure representing reusable scratch data of the algorithm for one graph
+ *
+ * @param nodes number of nodes in the graph
+ * @param edge_number number of edges in the graph
+ * @param edges edges of the graph, extracted once instead of once per source
+ */
+struct sssp_workspace {
+    int nodes;
+    int edge_number;
+    struct edge *edges;
+};
+
+/**
+ * @brief function relaxing the edges from a source, the core of the Bellman-Ford algorithm
+ *
+ * @param E array of edges
+ * @param edge_number number of edges
+ * @param node_count number of nodes
  * @param source_id ID of the source node
- * @return struct bellman_results results of the algorithm
+ * @param distances array to be filled with the distances
+ * @param predecessor array to be filled with the predecessors
  */
-struct bellman_results bellman_ford(struct graph *G, int source_id)
+void bellman_ford_relax(struct edge *E, int edge_number, int node_count, int source_id, int *distances, int *predecessor)
 {
-
-    // Prepare the structure for the algorithm
-    int *distances = (int *)calloc(G->nodes, sizeof(int));
-    int *predecessor = (int *)calloc(G->nodes, sizeof(int));
-
-    int node_count = G->nodes;
-
-    struct graph *working_graph = copy_graph(G);
-
     for (int i = 0; i < node_count; i++)
     {
         distances[i] = INFINITY;
@@ -58,10 +66,6 @@ struct bellman_results bellman_ford(struct graph *G, int source_id)
 
     distances[source_id] = 0;
 
-    // Retrieve edge data, this representation is preferred by the algorithm
-    int edge_number;
-    struct edge *E = extract_edges(working_graph, &edge_number);
-
     // Relax edges repeatedly
 
     // for (int i = 0; i < edge_number; i++)
@@ -141,17 +145,91 @@ struct bellman_results bellman_ford(struct graph *G, int source_id)
         
     }
 
+}
+
+/**
+ * @brief function implementing the Bellman-Ford algorithm
+ * 
+ * @param G pointer to the graph
+ * @param source_id ID of the source node
+ * @return struct bellman_results results of the algorithm
+ */
+struct bellman_results bellman_ford(struct graph *G, int source_id)
+{
+
+    // Prepare the structure for the algorithm
+    int *distances = (int *)calloc(G->nodes, sizeof(int));
+    int *predecessor = (int *)calloc(G->nodes, sizeof(int));
+
+    int node_count = G->nodes;
+
+    // Retrieve edge data, this representation is preferred by the algorithm
+    // The graph is only read, so there is no need for a working copy
+    int edge_number;
+    struct edge *E = extract_edges(G, &edge_number);
+
+    bellman_ford_relax(E, edge_number, node_count, source_id, distances, predecessor);
+
     struct bellman_results returned_data;
     returned_data.distance = distances;
     returned_data.predecessor = predecessor;
     returned_data.size = node_count;
 
-    free_graph(working_graph);
     free(E);
 
     return returned_data;
 }
 
+/**
+ * @brief function initializing the scratch data of the algorithm for a graph
+ *
+ * @param G pointer to the graph
+ * @return struct sssp_workspace* pointer to the workspace
+ */
+struct sssp_workspace *init_sssp_workspace(struct graph *G)
+{
+    struct sssp_workspace *ws = (struct sssp_workspace *)malloc(sizeof(struct sssp_workspace));
+
+    ws->nodes = G->nodes;
+    ws->edges = extract_edges(G, &ws->edge_number);
+
+    return ws;
+}
+
+/**
+ * @brief function freeing the scratch data of the algorithm
+ *
+ * @param ws pointer to the workspace
+ */
+void free_sssp_workspace(struct sssp_workspace *ws)
+{
+    if (ws != NULL)
+    {
+        free(ws->edges);
+        free(ws);
+    }
+}
+
+/**
+ * @brief function implementing the Bellman-Ford algorithm on reusable scratch memory
+ *
+ * @param ws pointer to the workspace of the graph
+ * @param A pointer to the arena holding the results, NULL to use the heap
+ * @param source_id ID of the source node
+ * @return struct bellman_results results of the algorithm, valid until the arena is reset
+ */
+struct bellman_results bellman_ford_scratch(struct sssp_workspace *ws, struct arena *A, int source_id)
+{
+    struct bellman_results returned_data;
+    returned_data.distance = (int *)scratch_alloc(A, sizeof(int) * ws->nodes);
+    returned_data.predecessor = (int *)scratch_alloc(A, sizeof(int) * ws->nodes);
+    returned_data.size = ws->nodes;
+
+    bellman_ford_relax(ws->edges, ws->edge_number, ws->nodes, source_id, returned_data.distance, returned_data.predecessor);
+
+    return returned_data;
+}
+
 // Source for the algorithm
 // https://en.wikipedia.org/wiki/Bellman%E2%80%93Ford_algorithm
 
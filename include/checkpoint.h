@@ -0,0 +1,371 @@
+/**
+ * @file checkpoint.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief periodic checkpoints of computed routers and resuming an interrupted run
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "stdint.h"
+#include "dirent.h"
+#include "fcntl.h"
+#include "unistd.h"
+
+#include "graph.h"
+#include "network.h"
+#include "router.h"
+
+/*
+
+Every process appends the node IDs of its finished routers to its own file:
+
+CHECKPOINT<rank>.txt
+FINGERPRINT <hash of routers and costs> ROUTERS <count>
+<node ID>
+...
+
+A node ID is appended only after its AS file was flushed to disk with fsync,
+and the checkpoint itself is synced before the next interval starts. A resumed
+run reads all checkpoint files with the same fingerprint (from any number of
+processes), skips the routers in them and deals the rest round robin over the
+current processes. Node 0 first merges the old files into CHECKPOINT0.txt so
+the other processes can start new ones.
+
+*/
+
+#define CHECKPOINT_PREFIX "CHECKPOINT"
+#define CHECKPOINT_MERGED "CHECKPOINT.tmp"
+
+/**
+ * @brief structure representing the checkpoint of a process
+ *
+ * @param fp checkpoint file of the process
+ * @param fingerprint hash of the topology
+ * @param as_map array mapping node IDs to AS numbers
+ * @param pending routers finished since the last checkpoint
+ * @param pending_count number of pending routers
+ * @param interval seconds between checkpoints
+ * @param last time of the last checkpoint
+ * @param checkpoints number of checkpoints written
+ * @param overhead seconds spent writing checkpoints
+ */
+struct checkpoint {
+    FILE *fp;
+    uint64_t fingerprint;
+    const int *as_map;
+    int *pending;
+    int pending_count;
+    double interval;
+    double last;
+    int checkpoints;
+    double overhead;
+};
+
+/**
+ * @brief function checking if a directory entry is a checkpoint file
+ *
+ * @param name name of the file
+ * @param rank pointer to the rank the file belongs to
+ * @return int 1 if it is a checkpoint file
+ */
+int is_checkpoint_file(const char *name, int *rank)
+{
+    char expected[64];
+
+    if (sscanf(name, CHECKPOINT_PREFIX "%i", rank) != 1 || *rank < 0)
+        return 0;
+
+    sprintf(expected, "%s%i.txt", CHECKPOINT_PREFIX, *rank);
+    return strcmp(name, expected) == 0;
+}
+
+/**
+ * @brief function reading a checkpoint file into the set of finished routers
+ *
+ * @param filename name of the checkpoint file
+ * @param fingerprint fingerprint of the current topology
+ * @param nodes number of routers
+ * @param done array marking finished routers
+ * @return int number of routers read, -1 if the file belongs to another topology
+ */
+int read_checkpoint(const char *filename, uint64_t fingerprint, int nodes, char *done)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL)
+        return 0;
+
+    char *line = NULL;
+    size_t len = 0;
+    unsigned long long hash;
+    int count;
+    int read = 0;
+
+    if (getline(&line, &len, fp) == -1 ||
+        sscanf(line, "FINGERPRINT %llx ROUTERS %i", &hash, &count) != 2 ||
+        hash != fingerprint || count != nodes)
+    {
+        free(line);
+        fclose(fp);
+        return -1;
+    }
+
+    ssize_t length;
+    while ((length = getline(&line, &len, fp)) != -1)
+    {
+        int node;
+
+        // A line cut off by a crash has no newline yet
+        if (line[length - 1] != '\n' || sscanf(line, "%i", &node) != 1 || node < 0 || node >= nodes)
+            continue;
+
+        done[node] = 1;
+        read++;
+    }
+
+    free(line);
+    fclose(fp);
+    return read;
+}
+
+/**
+ * @brief function writing a checkpoint header and flushing it to disk
+ *
+ * @param fp checkpoint file
+ * @param fingerprint fingerprint of the topology
+ * @param nodes number of routers
+ */
+void write_checkpoint_header(FILE *fp, uint64_t fingerprint, int nodes)
+{
+    fprintf(fp, "FINGERPRINT %016llx ROUTERS %i\n", (unsigned long long)fingerprint, nodes);
+    fflush(fp);
+    fsync(fileno(fp));
+}
+
+/**
+ * @brief function merging all checkpoint files into CHECKPOINT0.txt, run by node 0
+ *
+ * @param fingerprint fingerprint of the current topology
+ * @param nodes number of routers
+ * @param resume 1 to keep the finished routers, 0 to start over
+ * @param done array to be filled with the finished routers
+ * @return int 0 on success, -1 if the merged file cannot be written (the old files are kept)
+ */
+int merge_checkpoints(uint64_t fingerprint, int nodes, int resume, char *done)
+{
+    DIR *dir = opendir(".");
+    struct dirent *entry;
+    int owner;
+    int files = 0;
+
+    while (resume && dir != NULL && (entry = readdir(dir)) != NULL)
+    {
+        if (!is_checkpoint_file(entry->d_name, &owner))
+            continue;
+
+        if (read_checkpoint(entry->d_name, fingerprint, nodes, done) < 0)
+            printf("Checkpoint: ignoring %s of another topology\n", entry->d_name);
+        else
+            files++;
+    }
+
+    FILE *fp = fopen(CHECKPOINT_MERGED, "w");
+    if (fp == NULL)
+    {
+        printf("Checkpoint: cannot write %s\n", CHECKPOINT_MERGED);
+        if (dir != NULL)
+            closedir(dir);
+        return -1;
+    }
+
+    fprintf(fp, "FINGERPRINT %016llx ROUTERS %i\n", (unsigned long long)fingerprint, nodes);
+    for (int i = 0; i < nodes; i++)
+    {
+        if (done[i])
+            fprintf(fp, "%i\n", i);
+    }
+    fflush(fp);
+    fsync(fileno(fp));
+    fclose(fp);
+
+    // The merged file replaces CHECKPOINT0.txt atomically, only then the others go
+    rename(CHECKPOINT_MERGED, CHECKPOINT_PREFIX "0.txt");
+
+    if (dir != NULL)
+    {
+        rewinddir(dir);
+        while ((entry = readdir(dir)) != NULL)
+        {
+            if (is_checkpoint_file(entry->d_name, &owner) && owner != 0)
+                unlink(entry->d_name);
+        }
+        closedir(dir);
+    }
+
+    if (resume)
+        printf("Checkpoint: %i checkpoint files merged\n", files);
+
+    return 0;
+}
+
+/**
+ * @brief function flushing the AS files of the pending routers and recording them in the checkpoint
+ *
+ * @param C pointer to the checkpoint
+ */
+void write_checkpoint(struct checkpoint *C)
+{
+    double start = MPI_Wtime();
+    char file[128];
+
+    for (int p = 0; p < C->pending_count; p++)
+    {
+        sprintf(file, "./%s%i.txt", "AS", C->as_map[C->pending[p]]);
+
+        int fd = open(file, O_RDONLY);
+        if (fd >= 0)
+        {
+            fsync(fd);
+            close(fd);
+        }
+    }
+
+    for (int p = 0; p < C->pending_count; p++)
+        fprintf(C->fp, "%i\n", C->pending[p]);
+
+    fflush(C->fp);
+    fsync(fileno(C->fp));
+
+    C->pending_count = 0;
+    C->checkpoints++;
+    C->last = MPI_Wtime();
+    C->overhead += C->last - start;
+}
+
+/**
+ * @brief function computing the routers of the network with periodic checkpoints
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @param interval seconds between checkpoints
+ * @param resume 1 to skip the routers of earlier checkpoints
+ * @return int 0 on success, -1 on all nodes if a checkpoint file cannot be written (nothing was computed)
+ */
+int run_checkpointed(struct network *net, int rank, int size, double interval, int resume)
+{
+    int nodes = net->router_count;
+    char *done = (char *)calloc(nodes + 1, 1);
+    double start = MPI_Wtime();
+
+    struct checkpoint C;
+    C.fingerprint = network_fingerprint(net);
+    C.as_map = net->as_map;
+    C.pending = (int *)malloc(sizeof(int) * (nodes + 1));
+    C.pending_count = 0;
+    C.interval = interval;
+    C.checkpoints = 0;
+    C.overhead = 0;
+
+    int failed = 0;
+
+    if (rank == 0)
+        failed = merge_checkpoints(C.fingerprint, nodes, resume, done) != 0;
+
+    // Without the merged file the old checkpoints of the others must not be truncated
+    MPI_Bcast(&failed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(done, nodes, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    // Node 0 keeps appending to the merged file, the others start new ones
+    char file[128];
+    sprintf(file, "./%s%i.txt", CHECKPOINT_PREFIX, rank);
+    C.fp = failed ? NULL : fopen(file, rank == 0 ? "a" : "w");
+
+    if (C.fp == NULL && !failed)
+    {
+        printf("Checkpoint: cannot write %s\n", file);
+        failed = 1;
+    }
+
+    // A read only or full directory stops every process before anything is computed
+    int any_failed;
+    MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+    if (any_failed)
+    {
+        if (C.fp != NULL)
+            fclose(C.fp);
+        free(C.pending);
+        free(done);
+        return -1;
+    }
+
+    if (rank != 0)
+        write_checkpoint_header(C.fp, C.fingerprint, nodes);
+
+    // Unfinished routers are dealt round robin over the current processes
+    int skipped = 0;
+    int computed = 0;
+    int remaining = 0;
+
+    C.last = MPI_Wtime();
+
+    for (int i = 0; i < nodes; i++)
+    {
+        if (done[i])
+        {
+            skipped++;
+            continue;
+        }
+
+        if (remaining++ % size != rank)
+            continue;
+
+        struct router *rtr = generate_routing_info(net->as_map[i], net->netgraph, net->as_map, net->names[i]);
+        describe_router(rtr);
+        free_router(rtr);
+
+        C.pending[C.pending_count++] = i;
+        computed++;
+
+        if (MPI_Wtime() - C.last >= C.interval)
+            write_checkpoint(&C);
+    }
+
+    write_checkpoint(&C);
+    fclose(C.fp);
+
+    double elapsed = MPI_Wtime() - start;
+    double local[2] = {C.overhead, elapsed};
+    double worst[2];
+    int counts[2] = {computed, C.checkpoints};
+    int total[2];
+
+    MPI_Reduce(local, worst, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(counts, total, 2, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        printf("Checkpoint: %i routers skipped, %i computed, %i checkpoints every %.0f s\n",
+               skipped, total[0], total[1], interval);
+        printf("Checkpoint: %.3f s of %.3f s spent checkpointing on the slowest process (%.2f%%)\n",
+               worst[0], worst[1], worst[1] > 0 ? 100.0 * worst[0] / worst[1] : 0.0);
+    }
+
+    free(C.pending);
+    free(done);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,768 @@
+/**
+ * @file cluster.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief cluster decomposed routing, intra-cluster tables joined by a boundary overlay
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "limits.h"
+
+#include "bellford.h"
+#include "graph.h"
+#include "heap.h"
+#include "network.h"
+#include "router.h"
+
+/*
+
+Routers are grouped into clusters of at most max_size routers by label
+propagation over the links in both directions (a router takes the label most
+of its neighbours have, until no label changes). A boundary router has a link
+to or from another cluster, every path between clusters leaves through one
+boundary router X and enters through another one Y:
+
+d(U, V) = min(d_C(U, V), min over X, Y of d_C(U, X) + D(X, Y) + d_C(Y, V))
+
+where d_C are distances inside a cluster and D are the distances of the
+overlay graph, whose nodes are the boundary routers and whose edges are the
+links between clusters plus d_C between boundary routers of the same cluster.
+
+Clusters are dealt to the processes by their size. Every process computes the
+rows of its boundary routers inside their clusters, the rows are shared with
+Allgatherv so every process can build the overlay and knows d_C(Y, V) for all
+clusters. Then, one cluster at a time, a process runs Dijkstra on the overlay
+from the boundary routers of the cluster and Dijkstra inside the cluster from
+every router, and combines the three parts into the full table. The next hop
+comes from the first part of the route: the first hop inside the cluster, or
+the first overlay edge when U itself is the exit. Distances are exact, but on
+equal cost paths the chosen next hop may differ from the one of bellman_ford().
+
+Dijkstra needs non-negative costs, with a negative link every router is
+computed with Bellman-Ford as before.
+
+*/
+
+#define CLUSTER_ITERATIONS 20
+#define CLUSTER_UNREACHED (INT_MAX / 4)
+
+/**
+ * @brief structure representing the clusters, their boundary routers and owners
+ *
+ * @param nodes number of routers
+ * @param count number of clusters
+ * @param largest number of routers of the largest cluster
+ * @param label cluster of every router
+ * @param local index of every router in its cluster
+ * @param offset start of every cluster in members, count + 1 entries
+ * @param members routers grouped by cluster
+ * @param boundary_count number of boundary routers
+ * @param overlay_id overlay node of every router, -1 inside a cluster
+ * @param boundary router of every overlay node
+ * @param boundary_offset start of every cluster in boundary_members, count + 1 entries
+ * @param boundary_members overlay nodes grouped by cluster
+ * @param owner process computing every cluster
+ * @param row_offset start of the row of every overlay node in the shared tables
+ * @param row_count number of shared table entries
+ */
+struct cluster_plan {
+    int nodes;
+    int count;
+    int largest;
+    int *label;
+    int *local;
+    int *offset;
+    int *members;
+    int boundary_count;
+    int *overlay_id;
+    int *boundary;
+    int *boundary_offset;
+    int *boundary_members;
+    int *owner;
+    long *row_offset;
+    long row_count;
+};
+
+/**
+ * @brief function picking the default cluster size, twice the square root of the number of routers
+ *
+ * @param nodes number of routers
+ * @return int maximum number of routers of a cluster
+ */
+int cluster_default_size(int nodes)
+{
+    int root = 1;
+    while ((long)root * root < nodes)
+        root++;
+
+    return 2 * root < 16 ? 16 : 2 * root;
+}
+
+/**
+ * @brief function assigning a label to every router with size limited label propagation
+ *
+ * @param out outgoing edges of the graph
+ * @param in incoming edges of the graph
+ * @param max_size maximum number of routers with the same label
+ * @param label array to be filled with the labels
+ */
+void cluster_propagate_labels(struct adjacency *out, struct adjacency *in, int max_size, int *label)
+{
+    int nodes = out->nodes;
+    int *size = (int *)malloc(sizeof(int) * (nodes + 1));
+    int *count = (int *)calloc(nodes + 1, sizeof(int));
+    int *touched = (int *)malloc(sizeof(int) * (nodes + 1));
+    int *order = (int *)malloc(sizeof(int) * (nodes + 1));
+    unsigned int seed = 12345;
+
+    for (int i = 0; i < nodes; i++)
+    {
+        label[i] = i;
+        size[i] = 1;
+        order[i] = i;
+    }
+
+    // A fixed shuffle, every process gets the same clusters without communication
+    for (int i = nodes - 1; i > 0; i--)
+    {
+        seed = seed * 1103515245 + 12345;
+        int j = (seed >> 8) % (i + 1);
+        int swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+
+    for (int iteration = 0; iteration < CLUSTER_ITERATIONS; iteration++)
+    {
+        int changed = 0;
+
+        for (int o = 0; o < nodes; o++)
+        {
+            int v = order[o];
+            int touched_count = 0;
+
+            for (int side = 0; side < 2; side++)
+            {
+                struct adjacency *A = side ? in : out;
+                for (int k = A->offset[v]; k < A->offset[v + 1]; k++)
+                {
+                    int l = label[A->target[k]];
+                    if (count[l]++ == 0)
+                        touched[touched_count++] = l;
+                }
+            }
+
+            int best = label[v];
+            int best_count = count[label[v]];
+
+            for (int t = 0; t < touched_count; t++)
+            {
+                int l = touched[t];
+                if (l == label[v] || size[l] >= max_size)
+                    continue;
+
+                // On a tie the larger cluster wins, so small groups merge
+                if (count[l] > best_count || (count[l] == best_count && size[l] > size[best]))
+                {
+                    best = l;
+                    best_count = count[l];
+                }
+            }
+
+            for (int t = 0; t < touched_count; t++)
+                count[touched[t]] = 0;
+
+            if (best != label[v])
+            {
+                size[label[v]]--;
+                size[best]++;
+                label[v] = best;
+                changed = 1;
+            }
+        }
+
+        if (!changed)
+            break;
+    }
+
+    free(size);
+    free(count);
+    free(touched);
+    free(order);
+}
+
+/**
+ * @brief function partitioning the graph into clusters and dealing them to the processes
+ *
+ * @param out outgoing edges of the graph
+ * @param in incoming edges of the graph
+ * @param max_size maximum number of routers of a cluster
+ * @param size number of processes
+ * @return struct cluster_plan* pointer to the plan, the same on every process
+ */
+struct cluster_plan *partition_clusters(struct adjacency *out, struct adjacency *in, int max_size, int size)
+{
+    struct cluster_plan *P = (struct cluster_plan *)malloc(sizeof(struct cluster_plan));
+    int nodes = out->nodes;
+
+    P->nodes = nodes;
+    P->label = (int *)malloc(sizeof(int) * (nodes + 1));
+    P->local = (int *)malloc(sizeof(int) * (nodes + 1));
+    P->members = (int *)malloc(sizeof(int) * (nodes + 1));
+    P->overlay_id = (int *)malloc(sizeof(int) * (nodes + 1));
+    P->boundary = (int *)malloc(sizeof(int) * (nodes + 1));
+    P->boundary_members = (int *)malloc(sizeof(int) * (nodes + 1));
+
+    cluster_propagate_labels(out, in, max_size, P->label);
+
+    // Labels renumbered 0..count-1 in order of the first router
+    int *renumber = (int *)malloc(sizeof(int) * (nodes + 1));
+    for (int i = 0; i < nodes; i++)
+        renumber[i] = -1;
+
+    P->count = 0;
+    for (int i = 0; i < nodes; i++)
+    {
+        if (renumber[P->label[i]] < 0)
+            renumber[P->label[i]] = P->count++;
+        P->label[i] = renumber[P->label[i]];
+    }
+    free(renumber);
+
+    P->offset = (int *)calloc(P->count + 1, sizeof(int));
+    P->boundary_offset = (int *)calloc(P->count + 1, sizeof(int));
+    P->owner = (int *)malloc(sizeof(int) * (P->count + 1));
+
+    for (int i = 0; i < nodes; i++)
+        P->offset[P->label[i] + 1]++;
+    for (int c = 0; c < P->count; c++)
+        P->offset[c + 1] += P->offset[c];
+
+    P->largest = 0;
+    for (int c = 0; c < P->count; c++)
+    {
+        if (P->offset[c + 1] - P->offset[c] > P->largest)
+            P->largest = P->offset[c + 1] - P->offset[c];
+    }
+
+    int *fill = (int *)malloc(sizeof(int) * (P->count + 1));
+    memcpy(fill, P->offset, sizeof(int) * P->count);
+
+    for (int i = 0; i < nodes; i++)
+    {
+        int c = P->label[i];
+        P->local[i] = fill[c] - P->offset[c];
+        P->members[fill[c]++] = i;
+    }
+
+    // Boundary routers have a link to or from another cluster
+    P->boundary_count = 0;
+    for (int i = 0; i < nodes; i++)
+    {
+        int crossing = 0;
+
+        for (int k = out->offset[i]; k < out->offset[i + 1] && !crossing; k++)
+            crossing = P->label[out->target[k]] != P->label[i];
+        for (int k = in->offset[i]; k < in->offset[i + 1] && !crossing; k++)
+            crossing = P->label[in->target[k]] != P->label[i];
+
+        P->overlay_id[i] = -1;
+        if (crossing)
+        {
+            P->overlay_id[i] = P->boundary_count;
+            P->boundary[P->boundary_count++] = i;
+            P->boundary_offset[P->label[i] + 1]++;
+        }
+    }
+
+    for (int c = 0; c < P->count; c++)
+        P->boundary_offset[c + 1] += P->boundary_offset[c];
+
+    memcpy(fill, P->boundary_offset, sizeof(int) * P->count);
+    for (int b = 0; b < P->boundary_count; b++)
+        P->boundary_members[fill[P->label[P->boundary[b]]]++] = b;
+
+    // Largest clusters first, each one to the process with the least work so far
+    long *load = (long *)calloc(size, sizeof(long));
+    char *dealt = (char *)calloc(P->count + 1, 1);
+
+    for (int d = 0; d < P->count; d++)
+    {
+        int pick = -1;
+        for (int c = 0; c < P->count; c++)
+        {
+            if (!dealt[c] && (pick < 0 || P->offset[c + 1] - P->offset[c] > P->offset[pick + 1] - P->offset[pick]))
+                pick = c;
+        }
+
+        int lightest = 0;
+        for (int r = 1; r < size; r++)
+        {
+            if (load[r] < load[lightest])
+                lightest = r;
+        }
+
+        long members = P->offset[pick + 1] - P->offset[pick];
+        long exits = P->boundary_offset[pick + 1] - P->boundary_offset[pick];
+
+        P->owner[pick] = lightest;
+        load[lightest] += members * members + exits * P->boundary_count + members * exits;
+        dealt[pick] = 1;
+    }
+
+    // Shared rows ordered by owner, so the rows of every process are contiguous
+    P->row_offset = (long *)malloc(sizeof(long) * (P->boundary_count + 1));
+    P->row_count = 0;
+
+    for (int r = 0; r < size; r++)
+    {
+        for (int c = 0; c < P->count; c++)
+        {
+            if (P->owner[c] != r)
+                continue;
+
+            for (int b = P->boundary_offset[c]; b < P->boundary_offset[c + 1]; b++)
+            {
+                P->row_offset[P->boundary_members[b]] = P->row_count;
+                P->row_count += P->offset[c + 1] - P->offset[c];
+            }
+        }
+    }
+
+    free(fill);
+    free(load);
+    free(dealt);
+
+    return P;
+}
+
+/**
+ * @brief function freeing a cluster plan
+ *
+ * @param P pointer to the plan
+ */
+void free_cluster_plan(struct cluster_plan *P)
+{
+    free(P->label);
+    free(P->local);
+    free(P->offset);
+    free(P->members);
+    free(P->overlay_id);
+    free(P->boundary);
+    free(P->boundary_offset);
+    free(P->boundary_members);
+    free(P->owner);
+    free(P->row_offset);
+    free(P);
+}
+
+/**
+ * @brief function computing the distances from a router to the routers of its cluster, using only links inside it
+ *
+ * @param P pointer to the plan
+ * @param out outgoing edges of the graph
+ * @param H heap with capacity of the largest cluster
+ * @param source router the paths start at
+ * @param distance array to be filled with the distances, indexed by the local index
+ * @param first array to be filled with the first hop router, indexed by the local index
+ */
+void cluster_dijkstra(struct cluster_plan *P, struct adjacency *out, struct min_heap *H, int source, int *distance, int *first)
+{
+    int c = P->label[source];
+    int base = P->offset[c];
+    int members = P->offset[c + 1] - base;
+
+    for (int i = 0; i < members; i++)
+    {
+        distance[i] = CLUSTER_UNREACHED;
+        first[i] = NULL_PREDECESSOR;
+    }
+
+    distance[P->local[source]] = 0;
+    heap_push(H, P->local[source], 0);
+
+    while (H->size > 0)
+    {
+        int key;
+        int u_local = heap_pop(H, &key);
+        int u = P->members[base + u_local];
+
+        for (int k = out->offset[u]; k < out->offset[u + 1]; k++)
+        {
+            int v = out->target[k];
+            if (P->label[v] != c)
+                continue;
+
+            int v_local = P->local[v];
+            int candidate = key + out->cost[k];
+
+            if (candidate < distance[v_local])
+            {
+                distance[v_local] = candidate;
+                first[v_local] = u == source ? v : first[u_local];
+                heap_push(H, v_local, candidate);
+            }
+        }
+    }
+}
+
+/**
+ * @brief function computing the shared rows of the boundary routers of the clusters of a process
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param P pointer to the plan
+ * @param out outgoing edges of the graph
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @param row_distance array to be filled with the distances from every boundary router inside its cluster
+ * @param row_first array to be filled with the first hops from every boundary router inside its cluster
+ */
+void cluster_boundary_rows(struct cluster_plan *P, struct adjacency *out, int rank, int size, int *row_distance, int *row_first)
+{
+    struct min_heap *H = init_heap(P->largest);
+    int *counts = (int *)calloc(size, sizeof(int));
+    int *displs = (int *)calloc(size, sizeof(int));
+
+    for (int c = 0; c < P->count; c++)
+    {
+        long members = P->offset[c + 1] - P->offset[c];
+        counts[P->owner[c]] += members * (P->boundary_offset[c + 1] - P->boundary_offset[c]);
+    }
+    for (int r = 1; r < size; r++)
+        displs[r] = displs[r - 1] + counts[r - 1];
+
+    for (int c = 0; c < P->count; c++)
+    {
+        if (P->owner[c] != rank)
+            continue;
+
+        for (int b = P->boundary_offset[c]; b < P->boundary_offset[c + 1]; b++)
+        {
+            int y = P->boundary_members[b];
+            cluster_dijkstra(P, out, H, P->boundary[y], row_distance + P->row_offset[y], row_first + P->row_offset[y]);
+        }
+    }
+
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, row_distance, counts, displs, MPI_INT, MPI_COMM_WORLD);
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, row_first, counts, displs, MPI_INT, MPI_COMM_WORLD);
+
+    free_heap(H);
+    free(counts);
+    free(displs);
+}
+
+/**
+ * @brief function building the overlay graph of the boundary routers
+ *
+ * @param P pointer to the plan
+ * @param out outgoing edges of the graph
+ * @param row_distance shared distances from every boundary router inside its cluster
+ * @return struct adjacency* outgoing edges of the overlay, nodes are overlay IDs
+ */
+struct adjacency *cluster_overlay(struct cluster_plan *P, struct adjacency *out, const int *row_distance)
+{
+    struct adjacency *O = (struct adjacency *)malloc(sizeof(struct adjacency));
+    int B = P->boundary_count;
+
+    O->nodes = B;
+    O->offset = (int *)malloc(sizeof(int) * (B + 1));
+    O->offset[0] = 0;
+
+    // Two passes, counting and filling
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int y = 0; y < B; y++)
+        {
+            int u = P->boundary[y];
+            int c = P->label[u];
+            const int *row = row_distance + P->row_offset[y];
+            int k = O->offset[y];
+
+            for (int b = P->boundary_offset[c]; b < P->boundary_offset[c + 1]; b++)
+            {
+                int z = P->boundary_members[b];
+                int d = row[P->local[P->boundary[z]]];
+
+                if (z == y || d >= CLUSTER_UNREACHED)
+                    continue;
+
+                if (pass)
+                {
+                    O->target[k] = z;
+                    O->cost[k] = d;
+                }
+                k++;
+            }
+
+            for (int e = out->offset[u]; e < out->offset[u + 1]; e++)
+            {
+                int v = out->target[e];
+                if (P->label[v] == c)
+                    continue;
+
+                if (pass)
+                {
+                    O->target[k] = P->overlay_id[v];
+                    O->cost[k] = out->cost[e];
+                }
+                k++;
+            }
+
+            if (!pass)
+                O->offset[y + 1] = k;
+        }
+
+        if (!pass)
+        {
+            O->edges = O->offset[B];
+            O->target = (int *)malloc(sizeof(int) * (O->edges + 1));
+            O->cost = (int *)malloc(sizeof(int) * (O->edges + 1));
+        }
+    }
+
+    return O;
+}
+
+/**
+ * @brief function computing the overlay distances from a boundary router and the first hop towards every overlay node
+ *
+ * @param P pointer to the plan
+ * @param O overlay graph
+ * @param H heap with capacity of the overlay
+ * @param source overlay ID of the boundary router
+ * @param row_first shared first hops from every boundary router inside its cluster
+ * @param distance array to be filled with the overlay distances
+ * @param hop array to be filled with the first hop router
+ */
+void cluster_overlay_dijkstra(struct cluster_plan *P, struct adjacency *O, struct min_heap *H, int source,
+                              const int *row_first, int *distance, int *hop)
+{
+    int B = O->nodes;
+    int from = P->boundary[source];
+    const int *first = row_first + P->row_offset[source];
+
+    for (int y = 0; y < B; y++)
+    {
+        distance[y] = CLUSTER_UNREACHED;
+        hop[y] = NULL_PREDECESSOR;
+    }
+
+    distance[source] = 0;
+    heap_push(H, source, 0);
+
+    while (H->size > 0)
+    {
+        int key;
+        int u = heap_pop(H, &key);
+
+        for (int k = O->offset[u]; k < O->offset[u + 1]; k++)
+        {
+            int v = O->target[k];
+            int candidate = key + O->cost[k];
+
+            if (candidate >= distance[v])
+                continue;
+
+            distance[v] = candidate;
+
+            if (u != source)
+                hop[v] = hop[u];
+            else if (P->label[P->boundary[v]] == P->label[from])
+                hop[v] = first[P->local[P->boundary[v]]];
+            else
+                hop[v] = P->boundary[v];
+
+            heap_push(H, v, candidate);
+        }
+    }
+}
+
+/**
+ * @brief function computing the routers of a process from clusters and the boundary overlay
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @param max_size maximum number of routers of a cluster, 0 for the default
+ * @return int 0 on success, -1 if a link has a negative cost and nothing was computed
+ */
+int run_clusters(struct network *net, int rank, int size, int max_size)
+{
+    int nodes = net->router_count;
+
+    for (long i = 0; i < (long)nodes * nodes; i++)
+    {
+        if (net->netgraph->costs[i] < 0)
+        {
+            if (rank == 0)
+                printf("Clusters: negative link cost, computing every router with Bellman-Ford\n");
+            return -1;
+        }
+    }
+
+    double start = MPI_Wtime();
+
+    struct adjacency *out = extract_adjacency(net->netgraph, 0);
+    struct adjacency *in = extract_adjacency(net->netgraph, 1);
+    struct cluster_plan *P = partition_clusters(out, in, max_size > 0 ? max_size : cluster_default_size(nodes), size);
+    int B = P->boundary_count;
+
+    double partitioned = MPI_Wtime();
+
+    int *row_distance = (int *)malloc(sizeof(int) * (P->row_count + 1));
+    int *row_first = (int *)malloc(sizeof(int) * (P->row_count + 1));
+    cluster_boundary_rows(P, out, rank, size, row_distance, row_first);
+
+    struct adjacency *O = cluster_overlay(P, out, row_distance);
+
+    double shared = MPI_Wtime();
+
+    struct min_heap *H = init_heap(P->largest);
+    struct min_heap *overlay_heap = init_heap(B);
+    int *distance = (int *)malloc(sizeof(int) * (P->largest + 1));
+    int *first = (int *)malloc(sizeof(int) * (P->largest + 1));
+    int *through = (int *)malloc(sizeof(int) * (B + 1));
+    int *through_hop = (int *)malloc(sizeof(int) * (B + 1));
+
+    for (int c = 0; c < P->count; c++)
+    {
+        if (P->owner[c] != rank)
+            continue;
+
+        int exits = P->boundary_offset[c + 1] - P->boundary_offset[c];
+        int *overlay_distance = (int *)malloc(sizeof(int) * ((long)exits * B + 1));
+        int *overlay_hop = (int *)malloc(sizeof(int) * ((long)exits * B + 1));
+
+        for (int x = 0; x < exits; x++)
+            cluster_overlay_dijkstra(P, O, overlay_heap, P->boundary_members[P->boundary_offset[c] + x], row_first,
+                                     overlay_distance + (long)x * B, overlay_hop + (long)x * B);
+
+        for (int m = P->offset[c]; m < P->offset[c + 1]; m++)
+        {
+            int u = P->members[m];
+
+            cluster_dijkstra(P, out, H, u, distance, first);
+
+            // Best way to every boundary router through some exit of the cluster
+            for (int y = 0; y < B; y++)
+            {
+                through[y] = CLUSTER_UNREACHED;
+                through_hop[y] = NULL_PREDECESSOR;
+            }
+
+            for (int x = 0; x < exits; x++)
+            {
+                int exit = P->boundary[P->boundary_members[P->boundary_offset[c] + x]];
+                int to_exit = distance[P->local[exit]];
+                const int *D = overlay_distance + (long)x * B;
+                const int *Dhop = overlay_hop + (long)x * B;
+
+                if (to_exit >= CLUSTER_UNREACHED)
+                    continue;
+
+                for (int y = 0; y < B; y++)
+                {
+                    if (D[y] >= CLUSTER_UNREACHED || (exit == u && P->boundary[y] == u))
+                        continue;
+
+                    int candidate = to_exit + D[y];
+                    if (candidate < through[y])
+                    {
+                        through[y] = candidate;
+                        through_hop[y] = exit == u ? Dhop[y] : first[P->local[exit]];
+                    }
+                }
+            }
+
+            struct router *rtr = init_router(net->as_map[u], nodes, net->as_map, net->names[u]);
+            rtr->next_hop = (int *)malloc(sizeof(int) * nodes);
+            rtr->distance = (int *)malloc(sizeof(int) * nodes);
+
+            for (int v = 0; v < nodes; v++)
+            {
+                int cv = P->label[v];
+                int best = CLUSTER_UNREACHED;
+                int hop = v;
+
+                if (cv == c)
+                {
+                    best = distance[P->local[v]];
+                    hop = first[P->local[v]];
+                }
+
+                // Enter the cluster of V through one of its boundary routers
+                for (int b = P->boundary_offset[cv]; b < P->boundary_offset[cv + 1]; b++)
+                {
+                    int y = P->boundary_members[b];
+                    int inside = row_distance[P->row_offset[y] + P->local[v]];
+
+                    if (through[y] >= CLUSTER_UNREACHED || inside >= CLUSTER_UNREACHED)
+                        continue;
+
+                    if (through[y] + inside < best)
+                    {
+                        best = through[y] + inside;
+                        hop = through_hop[y];
+                    }
+                }
+
+                if (v == u)
+                {
+                    best = 0;
+                    hop = u;
+                }
+
+                rtr->distance[v] = best >= CLUSTER_UNREACHED ? INFINITY : best;
+                rtr->next_hop[v] = best >= CLUSTER_UNREACHED ? v : hop;
+            }
+
+            describe_router(rtr);
+            free_router(rtr);
+        }
+
+        free(overlay_distance);
+        free(overlay_hop);
+    }
+
+    double finished = MPI_Wtime();
+    double local[2] = {finished - shared, finished - start};
+    double slowest[2];
+    MPI_Reduce(local, slowest, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        printf("Clusters: %i clusters of at most %i routers (largest %i), %i boundary routers\n",
+               P->count, max_size > 0 ? max_size : cluster_default_size(nodes), P->largest, B);
+        printf("Clusters: overlay of %i nodes and %i edges, %li shared table entries\n", B, O->edges, P->row_count);
+        printf("Clusters: %.3f s partitioning, %.3f s boundary tables, %.3f s routers on the slowest process, %.3f s total\n",
+               partitioned - start, shared - partitioned, slowest[0], slowest[1]);
+    }
+
+    free_heap(H);
+    free_heap(overlay_heap);
+    free(distance);
+    free(first);
+    free(through);
+    free(through_hop);
+    free(row_distance);
+    free(row_first);
+    free_adjacency(O);
+    free_adjacency(out);
+    free_adjacency(in);
+    free_cluster_plan(P);
+
+    return 0;
+}
+
+#endif
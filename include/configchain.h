@@ -14,6 +14,7 @@
 
 #include "stdlib.h"
 #include "stdio.h"
+#include "string.h"
 
 /**
  * @brief structure representing a peer in the routing configuration
@@ -0,0 +1,1211 @@
+/**
+ * @file contraction.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief contraction hierarchy preprocessing, index file and point-to-point queries
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef CONTRACTION_H
+#define CONTRACTION_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "limits.h"
+
+#include "bellford.h"
+#include "graph.h"
+#include "heap.h"
+#include "network.h"
+#include "pathquery.h"
+
+/*
+
+Nodes are contracted from the least to the most important one. Contracting a
+node removes it from the remaining graph and adds a shortcut U -> W for every
+path U -> V -> W that has no cheaper witness path avoiding V. The importance
+(priority) is the edge difference, shortcuts added minus arcs removed, plus the
+number of already contracted neighbours so the contraction stays even.
+
+Every round contracts the nodes whose priority is a local minimum among their
+neighbours. They are independent, so their witness searches are spread over
+the processes and the shortcuts are exchanged with MPI_Allgatherv. Witness
+searches skip all nodes of the round.
+
+The arcs a node has when it is contracted only lead to more important nodes.
+A query runs Dijkstra upwards from the source over the outgoing ones and
+upwards from the destination over the incoming ones; the best node reached from
+both sides is on the shortest path. Shortcuts remember the node they bypass and
+are unpacked into original links for the full path.
+
+INDEX FILE [header with the fingerprint of the topology | as_map | level | out offsets | out arcs | in offsets | in arcs]
+
+Costs have to be non-negative.
+
+*/
+
+#define CH_MAGIC "BFCHIDX2"
+#define CH_SETTLE_LIMIT 500
+#define CH_ESTIMATE_LIMIT 50
+#define CH_UNREACHED (INT_MAX / 2)
+#define CH_ORIGINAL -1
+
+/**
+ * @brief structure representing an arc of the hierarchy
+ *
+ * @param node other end of the arc
+ * @param cost cost of the arc
+ * @param middle node bypassed by a shortcut, CH_ORIGINAL for links of the configuration
+ */
+struct ch_arc {
+    int node;
+    int cost;
+    int middle;
+};
+
+/**
+ * @brief structure representing a growable list of arcs
+ *
+ * @param count number of arcs
+ * @param capacity allocated number of arcs
+ * @param arc arcs
+ */
+struct ch_list {
+    int count;
+    int capacity;
+    struct ch_arc *arc;
+};
+
+/**
+ * @brief structure representing the state of the preprocessing
+ *
+ * @param nodes number of nodes
+ * @param out outgoing arcs of the remaining graph, then upward arcs of contracted nodes
+ * @param in incoming arcs of the remaining graph, then upward arcs of contracted nodes
+ * @param level contraction order of every node, -1 if not contracted yet
+ * @param priority priority of every node
+ * @param deleted number of contracted neighbours of every node
+ * @param in_round 1 for nodes contracted in the current round
+ * @param target 1 for the ends of the paths through the contracted node
+ * @param heap heap of the witness search
+ * @param distance distances of the witness search
+ * @param touched nodes reached by the witness search
+ * @param touched_count number of touched nodes
+ * @param shortcuts number of shortcuts added or improved
+ */
+struct ch_builder {
+    int nodes;
+    struct ch_list *out;
+    struct ch_list *in;
+    int *level;
+    int *priority;
+    int *deleted;
+    char *in_round;
+    char *target;
+    struct min_heap *heap;
+    int *distance;
+    int *touched;
+    int touched_count;
+    long shortcuts;
+};
+
+/**
+ * @brief structure representing the hierarchy used by queries
+ *
+ * @param nodes number of nodes
+ * @param as_map array mapping node IDs to AS numbers
+ * @param level contraction order of every node
+ * @param out_offset first upward outgoing arc of every node, nodes + 1 entries
+ * @param out upward outgoing arcs
+ * @param in_offset first upward incoming arc of every node, nodes + 1 entries
+ * @param in upward incoming arcs, node is the start of the arc
+ */
+struct ch_index {
+    int nodes;
+    int *as_map;
+    int *level;
+    int *out_offset;
+    struct ch_arc *out;
+    int *in_offset;
+    struct ch_arc *in;
+};
+
+/**
+ * @brief structure representing the header of an index file
+ *
+ * @param magic CH_MAGIC
+ * @param fingerprint network_fingerprint() of the configuration the index was built from
+ * @param nodes number of nodes
+ * @param out_arcs number of upward outgoing arcs
+ * @param in_arcs number of upward incoming arcs
+ */
+struct ch_header {
+    char magic[8];
+    uint64_t fingerprint;
+    int nodes;
+    int out_arcs;
+    int in_arcs;
+    int reserved;
+};
+
+/**
+ * @brief function adding an arc or lowering the cost of an existing one
+ *
+ * @param L pointer to the list
+ * @param node other end of the arc
+ * @param cost cost of the arc
+ * @param middle node bypassed by the arc, CH_ORIGINAL for a link
+ * @return int 1 if the list changed
+ */
+int ch_list_set(struct ch_list *L, int node, int cost, int middle)
+{
+    for (int k = 0; k < L->count; k++)
+    {
+        if (L->arc[k].node != node)
+            continue;
+
+        if (cost >= L->arc[k].cost)
+            return 0;
+
+        L->arc[k].cost = cost;
+        L->arc[k].middle = middle;
+        return 1;
+    }
+
+    if (L->count == L->capacity)
+    {
+        L->capacity = L->capacity ? 2 * L->capacity : 4;
+        L->arc = (struct ch_arc *)realloc(L->arc, sizeof(struct ch_arc) * L->capacity);
+    }
+
+    L->arc[L->count].node = node;
+    L->arc[L->count].cost = cost;
+    L->arc[L->count].middle = middle;
+    L->count++;
+    return 1;
+}
+
+/**
+ * @brief function removing the arc to a node
+ *
+ * @param L pointer to the list
+ * @param node other end of the arc
+ */
+void ch_list_remove(struct ch_list *L, int node)
+{
+    for (int k = 0; k < L->count; k++)
+    {
+        if (L->arc[k].node == node)
+        {
+            L->arc[k] = L->arc[--L->count];
+            return;
+        }
+    }
+}
+
+/**
+ * @brief function initializing the preprocessing from a graph
+ *
+ * @param G pointer to the graph
+ * @return struct ch_builder* pointer to the builder
+ */
+struct ch_builder *init_ch_builder(struct graph *G)
+{
+    struct ch_builder *B = (struct ch_builder *)calloc(1, sizeof(struct ch_builder));
+    int nodes = G->nodes;
+
+    B->nodes = nodes;
+    B->out = (struct ch_list *)calloc(nodes, sizeof(struct ch_list));
+    B->in = (struct ch_list *)calloc(nodes, sizeof(struct ch_list));
+    B->level = (int *)malloc(sizeof(int) * nodes);
+    B->priority = (int *)calloc(nodes, sizeof(int));
+    B->deleted = (int *)calloc(nodes, sizeof(int));
+    B->in_round = (char *)calloc(nodes, 1);
+    B->target = (char *)calloc(nodes, 1);
+    B->heap = init_heap(nodes);
+    B->distance = (int *)malloc(sizeof(int) * nodes);
+    B->touched = (int *)malloc(sizeof(int) * nodes);
+
+    struct adjacency *A = extract_adjacency(G, 0);
+
+    for (int u = 0; u < nodes; u++)
+    {
+        B->level[u] = -1;
+        B->distance[u] = CH_UNREACHED;
+
+        for (int k = A->offset[u]; k < A->offset[u + 1]; k++)
+        {
+            int w = A->target[k];
+            if (w == u)
+                continue;
+
+            ch_list_set(&B->out[u], w, A->cost[k], CH_ORIGINAL);
+            ch_list_set(&B->in[w], u, A->cost[k], CH_ORIGINAL);
+        }
+    }
+
+    free_adjacency(A);
+    return B;
+}
+
+/**
+ * @brief function freeing the builder
+ *
+ * @param B pointer to the builder
+ */
+void free_ch_builder(struct ch_builder *B)
+{
+    for (int i = 0; i < B->nodes; i++)
+    {
+        free(B->out[i].arc);
+        free(B->in[i].arc);
+    }
+
+    free(B->out);
+    free(B->in);
+    free(B->level);
+    free(B->priority);
+    free(B->deleted);
+    free(B->in_round);
+    free(B->target);
+    free_heap(B->heap);
+    free(B->distance);
+    free(B->touched);
+    free(B);
+}
+
+/**
+ * @brief function searching witness paths from a node in the remaining graph
+ *
+ * Dijkstra that skips the contracted node and all nodes of the round, stops at
+ * the cost limit, once all targets are settled or after settle_limit nodes.
+ * Nodes it did not reach count as without a witness, which only costs an
+ * unnecessary shortcut.
+ *
+ * @param B pointer to the builder
+ * @param source start of the search
+ * @param skip node being contracted
+ * @param limit largest cost worth searching
+ * @param targets number of nodes marked in B->target
+ * @param settle_limit largest number of nodes to settle
+ */
+void ch_witness(struct ch_builder *B, int source, int skip, int limit, int targets, int settle_limit)
+{
+    for (int t = 0; t < B->touched_count; t++)
+        B->distance[B->touched[t]] = CH_UNREACHED;
+
+    B->touched_count = 0;
+    heap_clear(B->heap);
+
+    B->distance[source] = 0;
+    B->touched[B->touched_count++] = source;
+    heap_push(B->heap, source, 0);
+
+    int settled = 0;
+    while (B->heap->size > 0 && targets > 0)
+    {
+        int key;
+        int u = heap_pop(B->heap, &key);
+
+        if (key > limit || ++settled > settle_limit)
+            break;
+
+        targets -= B->target[u];
+
+        struct ch_list *L = &B->out[u];
+        for (int k = 0; k < L->count; k++)
+        {
+            int v = L->arc[k].node;
+            int candidate = key + L->arc[k].cost;
+
+            if (v == skip || B->in_round[v] || candidate >= B->distance[v])
+                continue;
+
+            if (B->distance[v] == CH_UNREACHED)
+                B->touched[B->touched_count++] = v;
+
+            B->distance[v] = candidate;
+            heap_push(B->heap, v, candidate);
+        }
+    }
+}
+
+/**
+ * @brief function finding the shortcuts needed to contract a node
+ *
+ * @param B pointer to the builder
+ * @param v node to be contracted
+ * @param buffer pointer to the shortcuts found [SHORTCUT * 4 + from/to/cost/middle], NULL to only count them
+ * @param used pointer to the number of used entries of buffer
+ * @param capacity pointer to the number of allocated entries of buffer
+ * @return int number of shortcuts
+ */
+int ch_shortcuts(struct ch_builder *B, int v, int **buffer, int *used, int *capacity)
+{
+    struct ch_list *in = &B->in[v];
+    struct ch_list *out = &B->out[v];
+    int found = 0;
+    int max_out = 0;
+
+    for (int j = 0; j < out->count; j++)
+    {
+        if (out->arc[j].cost > max_out)
+            max_out = out->arc[j].cost;
+
+        B->target[out->arc[j].node] = 1;
+    }
+
+    // Priorities only need an estimate, a shorter search is enough
+    int settle_limit = buffer == NULL ? CH_ESTIMATE_LIMIT : CH_SETTLE_LIMIT;
+
+    for (int i = 0; i < in->count; i++)
+    {
+        int u = in->arc[i].node;
+        int to_v = in->arc[i].cost;
+
+        ch_witness(B, u, v, to_v + max_out, out->count - B->target[u], settle_limit);
+
+        for (int j = 0; j < out->count; j++)
+        {
+            int w = out->arc[j].node;
+            int need = to_v + out->arc[j].cost;
+
+            if (w == u || B->distance[w] <= need)
+                continue;
+
+            found++;
+
+            if (buffer == NULL)
+                continue;
+
+            if (*used + 4 > *capacity)
+            {
+                *capacity = 2 * (*used + 4);
+                *buffer = (int *)realloc(*buffer, sizeof(int) * *capacity);
+            }
+
+            (*buffer)[(*used)++] = u;
+            (*buffer)[(*used)++] = w;
+            (*buffer)[(*used)++] = need;
+            (*buffer)[(*used)++] = v;
+        }
+    }
+
+    for (int j = 0; j < out->count; j++)
+        B->target[out->arc[j].node] = 0;
+
+    return found;
+}
+
+/**
+ * @brief function computing the priorities of a list of nodes, spread over the processes
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param B pointer to the builder
+ * @param list nodes whose priority changed, the same on all processes
+ * @param count number of nodes in the list
+ * @param rank rank of the calling process
+ * @param size number of processes
+ */
+void ch_update_priorities(struct ch_builder *B, const int *list, int count, int rank, int size)
+{
+    int *values = (int *)calloc(count + 1, sizeof(int));
+
+    for (int k = rank; k < count; k += size)
+    {
+        int v = list[k];
+        int shortcuts = ch_shortcuts(B, v, NULL, NULL, NULL);
+        values[k] = shortcuts - B->in[v].count - B->out[v].count + B->deleted[v];
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, values, count, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    for (int k = 0; k < count; k++)
+        B->priority[list[k]] = values[k];
+
+    free(values);
+}
+
+/**
+ * @brief function checking if a node goes before a neighbour
+ *
+ * @param B pointer to the builder
+ * @param v node
+ * @param u neighbour
+ * @return int 1 if v has the lower priority (ties by node ID)
+ */
+int ch_before(struct ch_builder *B, int v, int u)
+{
+    return B->priority[v] < B->priority[u] || (B->priority[v] == B->priority[u] && v < u);
+}
+
+/**
+ * @brief function checking if a node goes before all of its remaining neighbours
+ *
+ * @param B pointer to the builder
+ * @param v node
+ * @return int 1 if v is a local minimum of the priority
+ */
+int ch_local_minimum(struct ch_builder *B, int v)
+{
+    for (int k = 0; k < B->out[v].count; k++)
+    {
+        if (!ch_before(B, v, B->out[v].arc[k].node))
+            return 0;
+    }
+
+    for (int k = 0; k < B->in[v].count; k++)
+    {
+        if (!ch_before(B, v, B->in[v].arc[k].node))
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief function building the contraction hierarchy of a graph, spread over the processes
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param G pointer to the graph
+ * @param as_map array mapping node IDs to AS numbers
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @param rounds pointer to the number of rounds
+ * @param shortcuts pointer to the number of shortcuts
+ * @return struct ch_index* hierarchy, the same on all processes
+ */
+struct ch_index *build_contraction_hierarchy(struct graph *G, const int *as_map, int rank, int size, int *rounds, long *shortcuts)
+{
+    struct ch_builder *B = init_ch_builder(G);
+    int nodes = B->nodes;
+    int *list = (int *)malloc(sizeof(int) * (nodes + 1));
+    int *round = (int *)malloc(sizeof(int) * (nodes + 1));
+    char *dirty = (char *)calloc(nodes, 1);
+    int list_count = nodes;
+    int order = 0;
+
+    int capacity = 1024;
+    int used = 0;
+    int *buffer = (int *)malloc(sizeof(int) * capacity);
+    int *counts = (int *)malloc(sizeof(int) * size);
+    int *displs = (int *)malloc(sizeof(int) * size);
+
+    for (int i = 0; i < nodes; i++)
+        list[i] = i;
+
+    *rounds = 0;
+
+    while (order < nodes)
+    {
+        ch_update_priorities(B, list, list_count, rank, size);
+
+        for (int k = 0; k < list_count; k++)
+            dirty[list[k]] = 0;
+
+        // Local minima of the priority are never neighbours of each other
+        int round_count = 0;
+        for (int v = 0; v < nodes; v++)
+        {
+            if (B->level[v] < 0 && ch_local_minimum(B, v))
+            {
+                round[round_count++] = v;
+                B->in_round[v] = 1;
+            }
+        }
+
+        used = 0;
+        for (int k = rank; k < round_count; k += size)
+            ch_shortcuts(B, round[k], &buffer, &used, &capacity);
+
+        MPI_Allgather(&used, 1, MPI_INT, counts, 1, MPI_INT, MPI_COMM_WORLD);
+
+        int total = 0;
+        for (int r = 0; r < size; r++)
+        {
+            displs[r] = total;
+            total += counts[r];
+        }
+
+        int *all = (int *)malloc(sizeof(int) * (total + 1));
+        MPI_Allgatherv(buffer, used, MPI_INT, all, counts, displs, MPI_INT, MPI_COMM_WORLD);
+
+        // Contracted nodes keep their arcs, they all lead to the remaining graph
+        for (int k = 0; k < round_count; k++)
+        {
+            int v = round[k];
+            B->level[v] = order++;
+            B->in_round[v] = 0;
+
+            for (int d = 0; d < 2; d++)
+            {
+                struct ch_list *L = d == 0 ? &B->out[v] : &B->in[v];
+
+                for (int a = 0; a < L->count; a++)
+                {
+                    int u = L->arc[a].node;
+
+                    ch_list_remove(d == 0 ? &B->in[u] : &B->out[u], v);
+                    B->deleted[u]++;
+                    dirty[u] = 1;
+                }
+            }
+        }
+
+        for (int k = 0; k < total; k += 4)
+        {
+            int u = all[k];
+            int w = all[k + 1];
+
+            if (ch_list_set(&B->out[u], w, all[k + 2], all[k + 3]))
+            {
+                ch_list_set(&B->in[w], u, all[k + 2], all[k + 3]);
+                B->shortcuts++;
+            }
+        }
+
+        // Lazy updates, a stale priority is recomputed once the node could be picked
+        list_count = 0;
+        for (int v = 0; v < nodes; v++)
+        {
+            if (B->level[v] < 0 && dirty[v] && ch_local_minimum(B, v))
+                list[list_count++] = v;
+        }
+
+        free(all);
+        (*rounds)++;
+    }
+
+    struct ch_index *I = (struct ch_index *)malloc(sizeof(struct ch_index));
+    I->nodes = nodes;
+    I->as_map = (int *)malloc(sizeof(int) * nodes);
+    I->level = B->level;
+    I->out_offset = (int *)malloc(sizeof(int) * (nodes + 1));
+    I->in_offset = (int *)malloc(sizeof(int) * (nodes + 1));
+    memcpy(I->as_map, as_map, sizeof(int) * nodes);
+    B->level = NULL;
+
+    I->out_offset[0] = 0;
+    I->in_offset[0] = 0;
+    for (int v = 0; v < nodes; v++)
+    {
+        I->out_offset[v + 1] = I->out_offset[v] + B->out[v].count;
+        I->in_offset[v + 1] = I->in_offset[v] + B->in[v].count;
+    }
+
+    I->out = (struct ch_arc *)malloc(sizeof(struct ch_arc) * (I->out_offset[nodes] + 1));
+    I->in = (struct ch_arc *)malloc(sizeof(struct ch_arc) * (I->in_offset[nodes] + 1));
+
+    for (int v = 0; v < nodes; v++)
+    {
+        memcpy(I->out + I->out_offset[v], B->out[v].arc, sizeof(struct ch_arc) * B->out[v].count);
+        memcpy(I->in + I->in_offset[v], B->in[v].arc, sizeof(struct ch_arc) * B->in[v].count);
+    }
+
+    *shortcuts = B->shortcuts;
+
+    free_ch_builder(B);
+    free(list);
+    free(round);
+    free(dirty);
+    free(buffer);
+    free(counts);
+    free(displs);
+
+    return I;
+}
+
+/**
+ * @brief function freeing the hierarchy
+ *
+ * @param I pointer to the hierarchy
+ */
+void free_ch_index(struct ch_index *I)
+{
+    if (I == NULL)
+        return;
+
+    free(I->as_map);
+    free(I->level);
+    free(I->out_offset);
+    free(I->out);
+    free(I->in_offset);
+    free(I->in);
+    free(I);
+}
+
+/**
+ * @brief function computing the size of the index file of a hierarchy
+ *
+ * @param I pointer to the hierarchy
+ * @return long size in bytes
+ */
+long ch_index_bytes(struct ch_index *I)
+{
+    return sizeof(struct ch_header) + sizeof(int) * (4L * I->nodes + 2) +
+           sizeof(struct ch_arc) * ((long)I->out_offset[I->nodes] + I->in_offset[I->nodes]);
+}
+
+/**
+ * @brief function writing the hierarchy to an index file
+ *
+ * @param I pointer to the hierarchy
+ * @param fingerprint fingerprint of the configuration the hierarchy was built from
+ * @param filename name of the index file
+ * @return int 0 on success, -1 if the file cannot be written
+ */
+int ch_save(struct ch_index *I, uint64_t fingerprint, const char *filename)
+{
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+        return -1;
+
+    struct ch_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CH_MAGIC, 8);
+    header.fingerprint = fingerprint;
+    header.nodes = I->nodes;
+    header.out_arcs = I->out_offset[I->nodes];
+    header.in_arcs = I->in_offset[I->nodes];
+
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(I->as_map, sizeof(int), I->nodes, fp);
+    fwrite(I->level, sizeof(int), I->nodes, fp);
+    fwrite(I->out_offset, sizeof(int), I->nodes + 1, fp);
+    fwrite(I->out, sizeof(struct ch_arc), header.out_arcs, fp);
+    fwrite(I->in_offset, sizeof(int), I->nodes + 1, fp);
+    fwrite(I->in, sizeof(struct ch_arc), header.in_arcs, fp);
+
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief function checking that the offsets and arcs of an index file can be followed safely
+ *
+ * @param offset first arc of every node, nodes + 1 entries
+ * @param arcs arcs
+ * @param nodes number of nodes
+ * @param count number of arcs
+ * @return int 1 if the offsets increase up to count and every arc stays inside the graph
+ */
+int ch_valid_arcs(int *offset, struct ch_arc *arcs, int nodes, int count)
+{
+    if (offset[0] != 0 || offset[nodes] != count)
+        return 0;
+
+    for (int v = 0; v < nodes; v++)
+    {
+        if (offset[v + 1] < offset[v])
+            return 0;
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        if (arcs[k].node < 0 || arcs[k].node >= nodes ||
+            arcs[k].middle < CH_ORIGINAL || arcs[k].middle >= nodes)
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief function reading the hierarchy from an index file
+ *
+ * @param filename name of the index file
+ * @param fingerprint pointer to the fingerprint stored in the file
+ * @return struct ch_index* pointer to the hierarchy, NULL if the file is missing or malformed
+ */
+struct ch_index *ch_load(const char *filename, uint64_t *fingerprint)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return NULL;
+
+    struct ch_header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, CH_MAGIC, 8) != 0 ||
+        header.nodes < 1 || header.out_arcs < 0 || header.in_arcs < 0)
+    {
+        fclose(fp);
+        return NULL;
+    }
+
+    struct ch_index *I = (struct ch_index *)malloc(sizeof(struct ch_index));
+    int nodes = header.nodes;
+
+    I->nodes = nodes;
+    I->as_map = (int *)malloc(sizeof(int) * nodes);
+    I->level = (int *)malloc(sizeof(int) * nodes);
+    I->out_offset = (int *)malloc(sizeof(int) * (nodes + 1));
+    I->out = (struct ch_arc *)malloc(sizeof(struct ch_arc) * (header.out_arcs + 1));
+    I->in_offset = (int *)malloc(sizeof(int) * (nodes + 1));
+    I->in = (struct ch_arc *)malloc(sizeof(struct ch_arc) * (header.in_arcs + 1));
+
+    size_t read = fread(I->as_map, sizeof(int), nodes, fp) +
+                  fread(I->level, sizeof(int), nodes, fp) +
+                  fread(I->out_offset, sizeof(int), nodes + 1, fp) +
+                  fread(I->out, sizeof(struct ch_arc), header.out_arcs, fp) +
+                  fread(I->in_offset, sizeof(int), nodes + 1, fp) +
+                  fread(I->in, sizeof(struct ch_arc), header.in_arcs, fp);
+    fclose(fp);
+
+    if (read != (size_t)(4 * nodes + 2 + header.out_arcs + header.in_arcs) ||
+        !ch_valid_arcs(I->out_offset, I->out, nodes, header.out_arcs) ||
+        !ch_valid_arcs(I->in_offset, I->in, nodes, header.in_arcs))
+    {
+        free_ch_index(I);
+        return NULL;
+    }
+
+    *fingerprint = header.fingerprint;
+    return I;
+}
+
+/**
+ * @brief function broadcasting the hierarchy of node 0 to all nodes
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param I pointer to the hierarchy on node 0, ignored on other nodes
+ * @param rank rank of the calling process
+ * @return struct ch_index* hierarchy, NULL on all nodes if node 0 has none
+ */
+struct ch_index *broadcast_ch_index(struct ch_index *I, int rank)
+{
+    int sizes[3] = {-1, 0, 0};
+
+    if (rank == 0 && I != NULL)
+    {
+        sizes[0] = I->nodes;
+        sizes[1] = I->out_offset[I->nodes];
+        sizes[2] = I->in_offset[I->nodes];
+    }
+
+    MPI_Bcast(sizes, 3, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (sizes[0] < 0)
+        return NULL;
+
+    int nodes = sizes[0];
+
+    if (rank != 0)
+    {
+        I = (struct ch_index *)malloc(sizeof(struct ch_index));
+        I->nodes = nodes;
+        I->as_map = (int *)malloc(sizeof(int) * nodes);
+        I->level = (int *)malloc(sizeof(int) * nodes);
+        I->out_offset = (int *)malloc(sizeof(int) * (nodes + 1));
+        I->out = (struct ch_arc *)malloc(sizeof(struct ch_arc) * (sizes[1] + 1));
+        I->in_offset = (int *)malloc(sizeof(int) * (nodes + 1));
+        I->in = (struct ch_arc *)malloc(sizeof(struct ch_arc) * (sizes[2] + 1));
+    }
+
+    // Arcs are plain ints, 3 per arc
+    MPI_Bcast(I->as_map, nodes, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(I->level, nodes, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(I->out_offset, nodes + 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(I->out, 3 * sizes[1], MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(I->in_offset, nodes + 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(I->in, 3 * sizes[2], MPI_INT, 0, MPI_COMM_WORLD);
+
+    return I;
+}
+
+/**
+ * @brief structure representing the scratch data of hierarchy queries
+ *
+ * @param nodes number of nodes
+ * @param heap heaps of both directions
+ * @param distance distances of both directions
+ * @param parent previous node of the direction
+ * @param parent_arc arc leading to the node from its parent
+ * @param touched nodes whose entries have to be reset after the query
+ * @param touched_count number of touched nodes
+ * @param mark 1 for touched nodes
+ * @param stack pending arcs of the unpacking [ENTRY * 3 + from/to/middle]
+ * @param chain nodes of the upward part from the source, from the meeting node down
+ * @param path path of the last query
+ */
+struct ch_query {
+    int nodes;
+    struct min_heap *heap[2];
+    int *distance[2];
+    int *parent[2];
+    const struct ch_arc **parent_arc[2];
+    int *touched;
+    int touched_count;
+    char *mark;
+    int *stack;
+    int *chain;
+    int *path;
+};
+
+/**
+ * @brief function initializing the scratch data of hierarchy queries
+ *
+ * @param nodes number of nodes
+ * @return struct ch_query* pointer to the scratch data
+ */
+struct ch_query *init_ch_query(int nodes)
+{
+    struct ch_query *Q = (struct ch_query *)malloc(sizeof(struct ch_query));
+
+    Q->nodes = nodes;
+    for (int d = 0; d < 2; d++)
+    {
+        Q->heap[d] = init_heap(nodes);
+        Q->distance[d] = (int *)malloc(sizeof(int) * nodes);
+        Q->parent[d] = (int *)malloc(sizeof(int) * nodes);
+        Q->parent_arc[d] = (const struct ch_arc **)malloc(sizeof(struct ch_arc *) * nodes);
+
+        for (int i = 0; i < nodes; i++)
+            Q->distance[d][i] = CH_UNREACHED;
+    }
+
+    Q->touched = (int *)malloc(sizeof(int) * nodes);
+    Q->touched_count = 0;
+    Q->mark = (char *)calloc(nodes, 1);
+    Q->stack = (int *)malloc(sizeof(int) * 3 * (nodes + 2));
+    Q->chain = (int *)malloc(sizeof(int) * (nodes + 1));
+    Q->path = (int *)malloc(sizeof(int) * (nodes + 1));
+
+    return Q;
+}
+
+/**
+ * @brief function freeing the scratch data of hierarchy queries
+ *
+ * @param Q pointer to the scratch data
+ */
+void free_ch_query(struct ch_query *Q)
+{
+    for (int d = 0; d < 2; d++)
+    {
+        free_heap(Q->heap[d]);
+        free(Q->distance[d]);
+        free(Q->parent[d]);
+        free(Q->parent_arc[d]);
+    }
+
+    free(Q->touched);
+    free(Q->mark);
+    free(Q->stack);
+    free(Q->chain);
+    free(Q->path);
+    free(Q);
+}
+
+/**
+ * @brief function finding the arc between two nodes stored at the less important one
+ *
+ * @param I pointer to the hierarchy
+ * @param low less important node
+ * @param high other end
+ * @param upward 1 for the arc low -> high, 0 for high -> low
+ * @return const struct ch_arc* the arc
+ */
+const struct ch_arc *ch_find_arc(struct ch_index *I, int low, int high, int upward)
+{
+    const struct ch_arc *arcs = upward ? I->out : I->in;
+    const int *offset = upward ? I->out_offset : I->in_offset;
+
+    for (int k = offset[low]; k < offset[low + 1]; k++)
+    {
+        if (arcs[k].node == high)
+            return &arcs[k];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief function appending the original links of an arc to the path
+ *
+ * @param Q pointer to the scratch data
+ * @param I pointer to the hierarchy
+ * @param from start of the arc
+ * @param to end of the arc
+ * @param middle node bypassed by the arc
+ * @param hops pointer to the length of the path
+ */
+void ch_unpack(struct ch_query *Q, struct ch_index *I, int from, int to, int middle, int *hops)
+{
+    int top = 0;
+
+    Q->stack[top++] = from;
+    Q->stack[top++] = to;
+    Q->stack[top++] = middle;
+
+    while (top > 0)
+    {
+        int m = Q->stack[--top];
+        int b = Q->stack[--top];
+        int a = Q->stack[--top];
+
+        if (m == CH_ORIGINAL)
+        {
+            Q->path[(*hops)++] = b;
+            continue;
+        }
+
+        // Both halves were arcs of m when it was contracted, a -> m comes out first
+        const struct ch_arc *second = ch_find_arc(I, m, b, 1);
+        const struct ch_arc *first = ch_find_arc(I, m, a, 0);
+
+        Q->stack[top++] = m;
+        Q->stack[top++] = b;
+        Q->stack[top++] = second->middle;
+        Q->stack[top++] = a;
+        Q->stack[top++] = m;
+        Q->stack[top++] = first->middle;
+    }
+}
+
+/**
+ * @brief function answering a query with the upward searches of the hierarchy
+ *
+ * @param Q pointer to the scratch data
+ * @param I pointer to the hierarchy
+ * @param source source node ID
+ * @param destination destination node ID
+ * @return struct path_result answer, the path is owned by Q and valid until the next query
+ */
+struct path_result ch_query_path(struct ch_query *Q, struct ch_index *I, int source, int destination)
+{
+    struct path_result result;
+    int ends[2] = {source, destination};
+    int best = CH_UNREACHED;
+    int meet = NULL_PREDECESSOR;
+
+    result.settled = 0;
+    result.negative_cycle = 0;
+    result.path = Q->path;
+
+    for (int d = 0; d < 2; d++)
+    {
+        Q->distance[d][ends[d]] = 0;
+        Q->parent[d][ends[d]] = NULL_PREDECESSOR;
+        heap_push(Q->heap[d], ends[d], 0);
+
+        if (!Q->mark[ends[d]])
+        {
+            Q->mark[ends[d]] = 1;
+            Q->touched[Q->touched_count++] = ends[d];
+        }
+    }
+
+    if (source == destination)
+    {
+        best = 0;
+        meet = source;
+    }
+
+    while (1)
+    {
+        int top[2];
+        for (int d = 0; d < 2; d++)
+            top[d] = Q->heap[d]->size > 0 ? heap_top_key(Q->heap[d]) : CH_UNREACHED;
+
+        // Upward searches meet at the most important node of the path, run both until they pass best
+        if (top[0] >= best && top[1] >= best)
+            break;
+
+        int d = top[0] <= top[1] ? 0 : 1;
+        int key;
+        int u = heap_pop(Q->heap[d], &key);
+        result.settled++;
+
+        const struct ch_arc *arcs = d == 0 ? I->out : I->in;
+        const int *offset = d == 0 ? I->out_offset : I->in_offset;
+
+        for (int k = offset[u]; k < offset[u + 1]; k++)
+        {
+            int v = arcs[k].node;
+            int candidate = key + arcs[k].cost;
+
+            if (candidate >= Q->distance[d][v])
+                continue;
+
+            Q->distance[d][v] = candidate;
+            Q->parent[d][v] = u;
+            Q->parent_arc[d][v] = &arcs[k];
+            heap_push(Q->heap[d], v, candidate);
+
+            if (!Q->mark[v])
+            {
+                Q->mark[v] = 1;
+                Q->touched[Q->touched_count++] = v;
+            }
+
+            if (Q->distance[1 - d][v] < CH_UNREACHED && candidate + Q->distance[1 - d][v] < best)
+            {
+                best = candidate + Q->distance[1 - d][v];
+                meet = v;
+            }
+        }
+    }
+
+    result.hops = 0;
+    result.distance = INFINITY;
+
+    if (meet != NULL_PREDECESSOR)
+    {
+        result.distance = best;
+
+        // Upward part from the source, collected backwards then unpacked in order
+        int chain = 0;
+        for (int v = meet; v != source; v = Q->parent[0][v])
+            Q->chain[chain++] = v;
+
+        Q->path[result.hops++] = source;
+        int from = source;
+        for (int c = chain - 1; c >= 0; c--)
+        {
+            int v = Q->chain[c];
+            ch_unpack(Q, I, from, v, Q->parent_arc[0][v]->middle, &result.hops);
+            from = v;
+        }
+
+        // Downward part, arcs of the backward search lead from a node to its parent
+        for (int v = meet; v != destination; v = Q->parent[1][v])
+            ch_unpack(Q, I, v, Q->parent[1][v], Q->parent_arc[1][v]->middle, &result.hops);
+    }
+
+    for (int t = 0; t < Q->touched_count; t++)
+    {
+        int v = Q->touched[t];
+        Q->distance[0][v] = CH_UNREACHED;
+        Q->distance[1][v] = CH_UNREACHED;
+        Q->mark[v] = 0;
+    }
+
+    Q->touched_count = 0;
+    heap_clear(Q->heap[0]);
+    heap_clear(Q->heap[1]);
+
+    return result;
+}
+
+/**
+ * @brief function building and saving the hierarchy and answering the queries of a file with it
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param build_file index file to be written, NULL to use load_file
+ * @param load_file index file to be read if build_file is NULL
+ * @param query_file name of the query file, NULL to only build the index
+ * @param rank rank of the calling process
+ * @param size number of processes
+ */
+void run_contraction(struct network *net, const char *build_file, const char *load_file,
+                     const char *query_file, int rank, int size)
+{
+    struct graph *G = net->netgraph;
+    int negative = 0;
+
+    for (int i = 0; i < G->nodes * G->nodes; i++)
+    {
+        if (G->costs[i] < 0)
+            negative = 1;
+    }
+
+    if (negative)
+    {
+        if (rank == 0)
+            printf("Contraction hierarchy: negative costs are not supported\n");
+
+        if (query_file != NULL)
+            run_path_queries(net, query_file, rank, size);
+        return;
+    }
+
+    struct ch_index *I = NULL;
+
+    if (build_file != NULL)
+    {
+        int rounds;
+        long shortcuts;
+        double start = MPI_Wtime();
+
+        I = build_contraction_hierarchy(G, net->as_map, rank, size, &rounds, &shortcuts);
+
+        double elapsed = MPI_Wtime() - start;
+
+        if (rank == 0)
+        {
+            if (ch_save(I, network_fingerprint(net), build_file) != 0)
+                printf("Contraction hierarchy: cannot write %s\n", build_file);
+
+            printf("Contraction hierarchy: %i nodes in %i rounds, %li shortcuts, %.3f s on %i processes\n",
+                   I->nodes, rounds, shortcuts, elapsed, size);
+            printf("Contraction hierarchy: %i upward arcs, index %s of %.1f kB\n",
+                   I->out_offset[I->nodes] + I->in_offset[I->nodes], build_file, ch_index_bytes(I) / 1024.0);
+        }
+
+        free_ch_index(I);
+        I = NULL;
+        load_file = build_file;
+    }
+
+    if (query_file == NULL)
+        return;
+
+    // Queries always use the index as it is on disk
+    if (rank == 0)
+    {
+        uint64_t fingerprint = 0;
+        I = ch_load(load_file, &fingerprint);
+
+        // Changed link costs keep the routers but make every stored shortcut wrong
+        if (I != NULL && (I->nodes != net->router_count || fingerprint != network_fingerprint(net) ||
+                          memcmp(I->as_map, net->as_map, sizeof(int) * I->nodes) != 0))
+        {
+            free_ch_index(I);
+            I = NULL;
+        }
+
+        if (I == NULL)
+            printf("Contraction hierarchy: %s is missing or does not match the configuration\n", load_file);
+    }
+
+    I = broadcast_ch_index(I, rank);
+
+    if (I == NULL)
+    {
+        run_path_queries(net, query_file, rank, size);
+        return;
+    }
+
+    int count;
+    int *pairs = broadcast_queries(query_file, net, rank, &count);
+    struct ch_query *Q = init_ch_query(I->nodes);
+
+    int capacity = 1024;
+    int used = 0;
+    int *answers = (int *)malloc(sizeof(int) * capacity);
+    int mine = 0;
+    double *latency = (double *)malloc(sizeof(double) * (count / size + 1));
+
+    for (int q = rank; q < count; q += size)
+    {
+        double start = MPI_Wtime();
+        struct path_result res = ch_query_path(Q, I, pairs[2 * q], pairs[2 * q + 1]);
+        latency[mine++] = MPI_Wtime() - start;
+
+        pack_path_answer(&answers, &used, &capacity, q, res);
+    }
+
+    write_path_answers(net, pairs, count, answers, used, latency, mine, "contraction hierarchy", rank, size);
+
+    free_ch_query(Q);
+    free_ch_index(I);
+    free(answers);
+    free(latency);
+    free(pairs);
+}
+
+#endif
@@ -0,0 +1,607 @@
+/**
+ * @file distvector.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief asynchronous distance-vector protocol between the processes owning peer routers
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef DISTVECTOR_H
+#define DISTVECTOR_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "bellford.h"
+#include "graph.h"
+#include "network.h"
+#include "router.h"
+
+/*
+
+Process R owns routers R, R + size, R + 2 * size... and keeps only their
+distance vectors. A router V with PEER U learns routes from U: whenever the
+distance of U to some destination improves, U sends the new value to every
+router V having U as a peer (split horizon, nothing is sent back to the peer
+U uses as next hop for that destination). Messages only go to processes owning
+such routers, so traffic scales with the degree and not with V * V. A process
+gets every update once and hands it to all of its routers peering with U.
+
+Changed entries are only marked dirty, once all pending messages are handled
+they are flushed in one batch per destination process, so several changes of
+the same entry are coalesced into one update.
+
+The topology does not change during the run, so distances only go down and
+routers do not need to keep the vectors advertised by their peers.
+
+Termination: a process that has nothing to send joins a non-blocking allreduce
+of (messages sent, messages received, activity since the previous wave). The
+protocol is done when a wave sees equal totals and no activity anywhere.
+
+*/
+
+#define DV_TAG 31
+#define DV_ENTRY_INTS 4
+#define DV_CHUNK 1024
+
+/**
+ * @brief structure representing an outstanding send
+ *
+ * @param request MPI request of the send
+ * @param buffer entries being sent
+ */
+struct dv_send {
+    MPI_Request request;
+    int *buffer;
+};
+
+/**
+ * @brief structure representing the distance-vector state of one process
+ *
+ * @param nodes number of routers in the network
+ * @param rank rank of the process
+ * @param size number of processes
+ * @param owned number of routers of the process
+ * @param out outgoing edges (PEER entries) of every router
+ * @param in incoming edges of every router, the routers to advertise to
+ * @param distance distance vectors of the owned routers [LOCAL * nodes + DESTINATION]
+ * @param hop next hops of the owned routers [LOCAL * nodes + DESTINATION]
+ * @param dirty 1 for entries changed since the last flush [LOCAL * nodes + DESTINATION]
+ * @param dirty_list changed destinations of every owned router [LOCAL * nodes + K]
+ * @param dirty_count number of changed destinations of every owned router
+ * @param stamp last entry sent to every process, to send each entry once per process
+ * @param stamp_id number of the entry being sent
+ * @param outgoing entries waiting for a flush, per destination process
+ * @param outgoing_count number of ints in outgoing, per destination process
+ * @param peer_ranks processes owning peers of the owned routers
+ * @param peer_count number of such processes
+ * @param recv_requests receive requests, one per peer process
+ * @param recv_buffers receive buffers, one per peer process
+ * @param sends outstanding sends
+ * @param send_count number of outstanding sends
+ * @param send_capacity capacity of sends
+ * @param floor lowest possible distance without a negative cycle
+ * @param negative_cycle 1 if a distance went below floor
+ * @param messages_sent number of sent messages
+ * @param messages_received number of received messages
+ * @param entries_sent number of sent entries
+ * @param local_entries number of entries applied without MPI (both routers on this process)
+ * @param rounds number of flushes that produced updates
+ * @param active 1 if anything happened since the last termination wave
+ */
+struct dv_state {
+    int nodes;
+    int rank;
+    int size;
+    int owned;
+    struct adjacency *out;
+    struct adjacency *in;
+    int *distance;
+    int *hop;
+    char *dirty;
+    int *dirty_list;
+    int *dirty_count;
+    long *stamp;
+    long stamp_id;
+    int **outgoing;
+    int *outgoing_count;
+    int *peer_ranks;
+    int peer_count;
+    MPI_Request *recv_requests;
+    int **recv_buffers;
+    struct dv_send *sends;
+    int send_count;
+    int send_capacity;
+    long floor;
+    int negative_cycle;
+    long messages_sent;
+    long messages_received;
+    long entries_sent;
+    long local_entries;
+    long rounds;
+    int active;
+};
+
+/**
+ * @brief function marking an entry of an owned router as changed
+ *
+ * @param D pointer to the state
+ * @param local local index of the router
+ * @param destination destination node ID
+ */
+void dv_mark(struct dv_state *D, int local, int destination)
+{
+    long cell = (long)local * D->nodes + destination;
+
+    if (!D->dirty[cell])
+    {
+        D->dirty[cell] = 1;
+        D->dirty_list[(long)local * D->nodes + D->dirty_count[local]++] = destination;
+    }
+}
+
+/**
+ * @brief function applying a route advertised by a peer
+ *
+ * @param D pointer to the state
+ * @param router owned router receiving the route
+ * @param destination destination node ID
+ * @param distance distance of the peer to the destination
+ * @param peer router advertising the route
+ */
+void dv_apply(struct dv_state *D, int router, int destination, int distance, int peer)
+{
+    int local = router / D->size;
+    long cell = (long)local * D->nodes + destination;
+
+    int cost = NO_CONNECTION;
+    for (int k = D->out->offset[router]; k < D->out->offset[router + 1]; k++)
+    {
+        if (D->out->target[k] == peer)
+        {
+            cost = D->out->cost[k];
+            break;
+        }
+    }
+
+    if (cost == NO_CONNECTION || distance >= INFINITY)
+        return;
+
+    long candidate = (long)cost + distance;
+
+    if (candidate < D->distance[cell])
+    {
+        if (candidate < D->floor)
+        {
+            D->negative_cycle = 1;
+            return;
+        }
+
+        D->distance[cell] = (int)candidate;
+        D->hop[cell] = peer;
+        dv_mark(D, local, destination);
+    }
+}
+
+/**
+ * @brief function handing a route advertised by a router of another process to our routers peering with it
+ *
+ * @param D pointer to the state
+ * @param peer router advertising the route
+ * @param destination destination node ID
+ * @param distance distance of the peer to the destination
+ * @param hop next hop of the peer, it does not get the route back (split horizon)
+ */
+void dv_receive(struct dv_state *D, int peer, int destination, int distance, int hop)
+{
+    for (int k = D->in->offset[peer]; k < D->in->offset[peer + 1]; k++)
+    {
+        int router = D->in->target[k];
+
+        if (router % D->size == D->rank && router != hop)
+            dv_apply(D, router, destination, distance, peer);
+    }
+}
+
+/**
+ * @brief function initializing the distance-vector state of a process
+ *
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @return struct dv_state* pointer to the state
+ */
+struct dv_state *init_dv_state(struct network *net, int rank, int size)
+{
+    struct dv_state *D = (struct dv_state *)calloc(1, sizeof(struct dv_state));
+    int nodes = net->router_count;
+
+    D->nodes = nodes;
+    D->rank = rank;
+    D->size = size;
+
+    for (int i = rank; i < nodes; i += size)
+        D->owned++;
+
+    D->out = extract_adjacency(net->netgraph, 0);
+    D->in = extract_adjacency(net->netgraph, 1);
+
+    long cells = (long)D->owned * nodes + 1;
+    D->distance = (int *)malloc(sizeof(int) * cells);
+    D->hop = (int *)malloc(sizeof(int) * cells);
+    D->dirty = (char *)calloc(cells, 1);
+    D->dirty_list = (int *)malloc(sizeof(int) * cells);
+    D->dirty_count = (int *)calloc(D->owned + 1, sizeof(int));
+
+    // Lowest distance reachable without a negative cycle
+    int largest = 0;
+    for (int k = 0; k < D->out->edges; k++)
+    {
+        if (abs(D->out->cost[k]) > largest)
+            largest = abs(D->out->cost[k]);
+    }
+    D->floor = -(long)largest * nodes;
+
+    for (int local = 0; local < D->owned; local++)
+    {
+        int router = rank + local * size;
+        for (int j = 0; j < nodes; j++)
+        {
+            D->distance[(long)local * nodes + j] = INFINITY;
+            D->hop[(long)local * nodes + j] = j;
+        }
+
+        D->distance[(long)local * nodes + router] = 0;
+        dv_mark(D, local, router);
+    }
+
+    // Processes owning peers of our routers, in either direction
+    char *is_peer = (char *)calloc(size, 1);
+    for (int local = 0; local < D->owned; local++)
+    {
+        int router = rank + local * size;
+        for (int k = D->out->offset[router]; k < D->out->offset[router + 1]; k++)
+            is_peer[D->out->target[k] % size] = 1;
+        for (int k = D->in->offset[router]; k < D->in->offset[router + 1]; k++)
+            is_peer[D->in->target[k] % size] = 1;
+    }
+    is_peer[rank] = 0;
+
+    D->peer_ranks = (int *)malloc(sizeof(int) * size);
+    for (int r = 0; r < size; r++)
+    {
+        if (is_peer[r])
+            D->peer_ranks[D->peer_count++] = r;
+    }
+    free(is_peer);
+
+    D->outgoing = (int **)malloc(sizeof(int *) * size);
+    D->outgoing_count = (int *)calloc(size, sizeof(int));
+    D->stamp = (long *)calloc(size, sizeof(long));
+    for (int r = 0; r < size; r++)
+    {
+        D->outgoing[r] = (int *)malloc(sizeof(int) * DV_ENTRY_INTS * DV_CHUNK);
+    }
+
+    D->recv_requests = (MPI_Request *)malloc(sizeof(MPI_Request) * (D->peer_count + 1));
+    D->recv_buffers = (int **)malloc(sizeof(int *) * (D->peer_count + 1));
+    for (int p = 0; p < D->peer_count; p++)
+    {
+        D->recv_buffers[p] = (int *)malloc(sizeof(int) * DV_ENTRY_INTS * DV_CHUNK);
+        MPI_Irecv(D->recv_buffers[p], DV_ENTRY_INTS * DV_CHUNK, MPI_INT, D->peer_ranks[p], DV_TAG, MPI_COMM_WORLD, &D->recv_requests[p]);
+    }
+
+    D->send_capacity = 16;
+    D->sends = (struct dv_send *)malloc(sizeof(struct dv_send) * D->send_capacity);
+
+    return D;
+}
+
+/**
+ * @brief function sending the pending entries for one process
+ *
+ * @param D pointer to the state
+ * @param target destination process
+ */
+void dv_send_pending(struct dv_state *D, int target)
+{
+    if (D->outgoing_count[target] == 0)
+        return;
+
+    if (D->send_count == D->send_capacity)
+    {
+        D->send_capacity *= 2;
+        D->sends = (struct dv_send *)realloc(D->sends, sizeof(struct dv_send) * D->send_capacity);
+    }
+
+    // The filled buffer travels with the request, a fresh one takes its place
+    struct dv_send *send = &D->sends[D->send_count++];
+    send->buffer = D->outgoing[target];
+    MPI_Isend(send->buffer, D->outgoing_count[target], MPI_INT, target, DV_TAG, MPI_COMM_WORLD, &send->request);
+
+    D->outgoing[target] = (int *)malloc(sizeof(int) * DV_ENTRY_INTS * DV_CHUNK);
+    D->outgoing_count[target] = 0;
+    D->messages_sent++;
+}
+
+/**
+ * @brief function advertising all changed entries to the peers of their routers
+ *
+ * @param D pointer to the state
+ * @return int 1 if anything was flushed
+ */
+int dv_flush(struct dv_state *D)
+{
+    int flushed = 0;
+
+    // Local deliveries may dirty more entries, keep going until everything is out
+    int again = 1;
+    while (again)
+    {
+        again = 0;
+
+        for (int local = 0; local < D->owned; local++)
+        {
+            int router = D->rank + local * D->size;
+
+            while (D->dirty_count[local] > 0)
+            {
+                int destination = D->dirty_list[(long)local * D->nodes + --D->dirty_count[local]];
+                long cell = (long)local * D->nodes + destination;
+                D->dirty[cell] = 0;
+                flushed = 1;
+
+                D->stamp_id++;
+
+                for (int k = D->in->offset[router]; k < D->in->offset[router + 1]; k++)
+                {
+                    int neighbour = D->in->target[k];
+
+                    // Split horizon
+                    if (D->hop[cell] == neighbour)
+                        continue;
+
+                    int target = neighbour % D->size;
+
+                    if (target == D->rank)
+                    {
+                        dv_apply(D, neighbour, destination, D->distance[cell], router);
+                        D->local_entries++;
+                        again = 1;
+                        continue;
+                    }
+
+                    // One entry per process, it is handed to all its routers peering with us
+                    if (D->stamp[target] == D->stamp_id)
+                        continue;
+                    D->stamp[target] = D->stamp_id;
+
+                    int *entry = D->outgoing[target] + D->outgoing_count[target];
+                    entry[0] = router;
+                    entry[1] = destination;
+                    entry[2] = D->distance[cell];
+                    entry[3] = D->hop[cell];
+                    D->outgoing_count[target] += DV_ENTRY_INTS;
+                    D->entries_sent++;
+
+                    if (D->outgoing_count[target] == DV_ENTRY_INTS * DV_CHUNK)
+                        dv_send_pending(D, target);
+                }
+            }
+        }
+    }
+
+    for (int r = 0; r < D->size; r++)
+    {
+        dv_send_pending(D, r);
+    }
+
+    if (flushed)
+    {
+        D->rounds++;
+        D->active = 1;
+    }
+
+    return flushed;
+}
+
+/**
+ * @brief function handling all received messages and completed sends
+ *
+ * @param D pointer to the state
+ */
+void dv_progress(struct dv_state *D)
+{
+    int received = 1;
+
+    while (received && D->peer_count > 0)
+    {
+        int index;
+        MPI_Status status;
+        MPI_Testany(D->peer_count, D->recv_requests, &index, &received, &status);
+
+        if (!received || index == MPI_UNDEFINED)
+            break;
+
+        int count;
+        MPI_Get_count(&status, MPI_INT, &count);
+
+        int *buffer = D->recv_buffers[index];
+        for (int e = 0; e < count; e += DV_ENTRY_INTS)
+        {
+            dv_receive(D, buffer[e], buffer[e + 1], buffer[e + 2], buffer[e + 3]);
+        }
+
+        D->messages_received++;
+        D->active = 1;
+
+        MPI_Irecv(buffer, DV_ENTRY_INTS * DV_CHUNK, MPI_INT, D->peer_ranks[index], DV_TAG, MPI_COMM_WORLD, &D->recv_requests[index]);
+    }
+
+    // Release the buffers of completed sends
+    int kept = 0;
+    for (int s = 0; s < D->send_count; s++)
+    {
+        int done;
+        MPI_Test(&D->sends[s].request, &done, MPI_STATUS_IGNORE);
+
+        if (done)
+            free(D->sends[s].buffer);
+        else
+            D->sends[kept++] = D->sends[s];
+    }
+    D->send_count = kept;
+}
+
+/**
+ * @brief function checking whether a process has changed entries waiting for a flush
+ *
+ * @param D pointer to the state
+ * @return int 1 if there are changed entries
+ */
+int dv_has_dirty(struct dv_state *D)
+{
+    for (int local = 0; local < D->owned; local++)
+    {
+        if (D->dirty_count[local] > 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief function freeing the distance-vector state
+ *
+ * @param D pointer to the state
+ */
+void free_dv_state(struct dv_state *D)
+{
+    for (int p = 0; p < D->peer_count; p++)
+    {
+        MPI_Cancel(&D->recv_requests[p]);
+        MPI_Wait(&D->recv_requests[p], MPI_STATUS_IGNORE);
+        free(D->recv_buffers[p]);
+    }
+
+    for (int s = 0; s < D->send_count; s++)
+    {
+        MPI_Wait(&D->sends[s].request, MPI_STATUS_IGNORE);
+        free(D->sends[s].buffer);
+    }
+
+    for (int r = 0; r < D->size; r++)
+    {
+        free(D->outgoing[r]);
+    }
+
+    free_adjacency(D->out);
+    free_adjacency(D->in);
+    free(D->distance);
+    free(D->hop);
+    free(D->dirty);
+    free(D->dirty_list);
+    free(D->dirty_count);
+    free(D->outgoing);
+    free(D->outgoing_count);
+    free(D->stamp);
+    free(D->peer_ranks);
+    free(D->recv_requests);
+    free(D->recv_buffers);
+    free(D->sends);
+    free(D);
+}
+
+/**
+ * @brief function running the distance-vector protocol and describing the routers of a process
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param size number of processes
+ */
+void run_distance_vector(struct network *net, int rank, int size)
+{
+    double start = MPI_Wtime();
+    struct dv_state *D = init_dv_state(net, rank, size);
+
+    MPI_Request wave = MPI_REQUEST_NULL;
+    long wave_local[3];
+    long wave_total[3];
+    long waves = 0;
+    int finished = 0;
+
+    while (!finished)
+    {
+        dv_progress(D);
+        dv_flush(D);
+
+        if (wave == MPI_REQUEST_NULL)
+        {
+            // Join the next termination wave only with nothing left to send
+            if (!dv_has_dirty(D))
+            {
+                wave_local[0] = D->messages_sent;
+                wave_local[1] = D->messages_received;
+                wave_local[2] = D->active;
+                D->active = 0;
+                MPI_Iallreduce(wave_local, wave_total, 3, MPI_LONG, MPI_SUM, MPI_COMM_WORLD, &wave);
+            }
+        }
+        else
+        {
+            int done;
+            MPI_Test(&wave, &done, MPI_STATUS_IGNORE);
+
+            if (done)
+            {
+                waves++;
+                finished = wave_total[0] == wave_total[1] && wave_total[2] == 0;
+            }
+        }
+    }
+
+    double elapsed = MPI_Wtime() - start;
+
+    for (int local = 0; local < D->owned; local++)
+    {
+        int router = rank + local * size;
+        struct router *rtr = init_router(net->as_map[router], D->nodes, net->as_map, net->names[router]);
+
+        rtr->next_hop = (int *)malloc(sizeof(int) * D->nodes);
+        rtr->distance = (int *)malloc(sizeof(int) * D->nodes);
+        memcpy(rtr->next_hop, D->hop + (long)local * D->nodes, sizeof(int) * D->nodes);
+        memcpy(rtr->distance, D->distance + (long)local * D->nodes, sizeof(int) * D->nodes);
+
+        describe_router(rtr);
+        free_router(rtr);
+    }
+
+    long local_counts[5] = {D->messages_sent, D->entries_sent, D->local_entries, D->negative_cycle, D->peer_count};
+    long totals[5];
+    long max_rounds;
+
+    MPI_Reduce(local_counts, totals, 5, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&D->rounds, &max_rounds, 1, MPI_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        printf("Distance vector: converged in %.3f s, %li flush rounds on the busiest process, %li termination waves\n",
+               elapsed, max_rounds, waves);
+        printf("Distance vector: %li messages, %li entries (%li bytes) between processes, %li entries delivered locally\n",
+               totals[0], totals[1], totals[1] * DV_ENTRY_INTS * (long)sizeof(int), totals[2]);
+        printf("Distance vector: %.1f peer processes per process\n", (double)totals[4] / size);
+
+        if (totals[3] > 0)
+            printf("Graph contains a negative-weight cycle\n");
+    }
+
+    free_dv_state(D);
+}
+
+#endif
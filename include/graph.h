@@ -15,6 +15,7 @@
 #include "stdlib.h"
 #include "string.h"
 #include "configchain.h"
+#include "largemem.h"
 
 #define NO_CONNECTION 9999
 
@@ -80,6 +81,7 @@ struct graph *init_graph(int size)
     struct graph *newGraph = malloc(sizeof(struct graph));
     newGraph->nodes = size;
     newGraph->costs = calloc(size * size, sizeof(int));
+    large_advise(newGraph->costs, (size_t)size * size * sizeof(int));
 
     for (int i = 0; i < size * size; i++)
     {
@@ -100,6 +102,7 @@ struct graph *copy_graph(struct graph *otherGraph)
     struct graph *newGraph = malloc(sizeof(struct graph));
     newGraph->nodes = otherGraph->nodes;
     newGraph->costs = calloc(otherGraph->nodes * otherGraph->nodes, sizeof(int));
+    large_advise(newGraph->costs, (size_t)otherGraph->nodes * otherGraph->nodes * sizeof(int));
     memcpy(newGraph->costs, otherGraph->costs, otherGraph->nodes * otherGraph->nodes * sizeof(int));
     return newGraph;
 }
@@ -191,6 +194,7 @@ struct edge *extract_edges(struct graph *G, int *amount)
     }
 
     struct edge *found = malloc(counted_amount * sizeof(struct edge));
+    large_advise(found, counted_amount * sizeof(struct edge));
 
     counted_amount = 0;
 
@@ -215,6 +219,92 @@ struct edge *extract_edges(struct graph *G, int *amount)
     return found;
 }
 
+/**
+ * @brief structure representing the graph as adjacency lists (CSR)
+ *
+ * @param nodes number of nodes in the graph
+ * @param edges number of edges in the graph
+ * @param offset start of the edges of every node [nodes + 1]
+ * @param target other end of every edge
+ * @param cost cost of every edge
+ */
+struct adjacency
+{
+    int nodes;
+    int edges;
+    int *offset;
+    int *target;
+    int *cost;
+};
+
+/**
+ * @brief function extracting adjacency lists from the graph
+ *
+ * @param G pointer to the graph
+ * @param incoming 0 for lists of outgoing edges, 1 for lists of incoming edges
+ * @return struct adjacency* pointer to the adjacency lists, sorted by the other end
+ */
+struct adjacency *extract_adjacency(struct graph *G, int incoming)
+{
+    int nodes = G->nodes;
+    struct adjacency *A = malloc(sizeof(struct adjacency));
+
+    A->nodes = nodes;
+    A->offset = malloc(sizeof(int) * (nodes + 1));
+    A->offset[0] = 0;
+
+    for (int i = 0; i < nodes; i++)
+    {
+        int degree = 0;
+        for (int j = 0; j < nodes; j++)
+        {
+            int value = incoming ? get_edge(G, j, i) : get_edge(G, i, j);
+            if (i != j && value != NO_CONNECTION)
+                degree++;
+        }
+        A->offset[i + 1] = A->offset[i] + degree;
+    }
+
+    A->edges = A->offset[nodes];
+    A->target = malloc(sizeof(int) * (A->edges + 1));
+    A->cost = malloc(sizeof(int) * (A->edges + 1));
+    large_advise(A->target, sizeof(int) * (A->edges + 1));
+    large_advise(A->cost, sizeof(int) * (A->edges + 1));
+
+    for (int i = 0; i < nodes; i++)
+    {
+        int k = A->offset[i];
+        for (int j = 0; j < nodes; j++)
+        {
+            int value = incoming ? get_edge(G, j, i) : get_edge(G, i, j);
+            if (i != j && value != NO_CONNECTION)
+            {
+                A->target[k] = j;
+                A->cost[k] = value;
+                k++;
+            }
+        }
+    }
+
+    return A;
+}
+
+/**
+ * @brief function freeing adjacency lists
+ *
+ * @param A pointer to the adjacency lists
+ */
+void free_adjacency(struct adjacency *A)
+{
+    if (A != NULL)
+    {
+        free(A->offset);
+        free(A->target);
+        free(A->cost);
+        free(A);
+    }
+}
+
 /**
  * @brief function printing visual representation of the graph
  * 
@@ -0,0 +1,225 @@
+/**
+ * @file heap.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief indexed binary min-heap of nodes used by the Dijkstra based engines
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "stdlib.h"
+
+#define HEAP_ABSENT -1
+
+/**
+ * @brief structure representing a min-heap of nodes keyed by their distance
+ *
+ * @param size number of nodes in the heap
+ * @param capacity maximum number of nodes (number of nodes in the graph)
+ * @param node nodes in heap order
+ * @param key keys in heap order
+ * @param position position of every node in the heap, HEAP_ABSENT if not in the heap
+ */
+struct min_heap {
+    int size;
+    int capacity;
+    int *node;
+    int *key;
+    int *position;
+};
+
+/**
+ * @brief function initializing an empty heap
+ *
+ * @param capacity number of nodes in the graph
+ * @return struct min_heap* pointer to the initialized heap
+ */
+struct min_heap *init_heap(int capacity)
+{
+    struct min_heap *H = (struct min_heap *)malloc(sizeof(struct min_heap));
+
+    H->size = 0;
+    H->capacity = capacity;
+    H->node = (int *)malloc(sizeof(int) * (capacity + 1));
+    H->key = (int *)malloc(sizeof(int) * (capacity + 1));
+    H->position = (int *)malloc(sizeof(int) * (capacity + 1));
+
+    for (int i = 0; i < capacity; i++)
+    {
+        H->position[i] = HEAP_ABSENT;
+    }
+
+    return H;
+}
+
+/**
+ * @brief function swapping two heap entries
+ *
+ * @param H pointer to the heap
+ * @param a first position
+ * @param b second position
+ */
+void heap_swap(struct min_heap *H, int a, int b)
+{
+    int node = H->node[a];
+    int key = H->key[a];
+
+    H->node[a] = H->node[b];
+    H->key[a] = H->key[b];
+    H->node[b] = node;
+    H->key[b] = key;
+
+    H->position[H->node[a]] = a;
+    H->position[H->node[b]] = b;
+}
+
+/**
+ * @brief function moving an entry up until the heap order holds
+ *
+ * @param H pointer to the heap
+ * @param i position of the entry
+ */
+void heap_sift_up(struct min_heap *H, int i)
+{
+    while (i > 0 && H->key[(i - 1) / 2] > H->key[i])
+    {
+        heap_swap(H, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+/**
+ * @brief function moving an entry down until the heap order holds
+ *
+ * @param H pointer to the heap
+ * @param i position of the entry
+ */
+void heap_sift_down(struct min_heap *H, int i)
+{
+    while (1)
+    {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+
+        if (left < H->size && H->key[left] < H->key[smallest])
+            smallest = left;
+        if (right < H->size && H->key[right] < H->key[smallest])
+            smallest = right;
+
+        if (smallest == i)
+            return;
+
+        heap_swap(H, i, smallest);
+        i = smallest;
+    }
+}
+
+/**
+ * @brief function inserting a node or lowering its key if it is already in the heap
+ *
+ * @param H pointer to the heap
+ * @param node node to be inserted
+ * @param key new key of the node
+ */
+void heap_push(struct min_heap *H, int node, int key)
+{
+    int i = H->position[node];
+
+    if (i == HEAP_ABSENT)
+    {
+        i = H->size++;
+        H->node[i] = node;
+        H->key[i] = key;
+        H->position[node] = i;
+    }
+    else if (key < H->key[i])
+    {
+        H->key[i] = key;
+    }
+    else
+    {
+        return;
+    }
+
+    heap_sift_up(H, i);
+}
+
+/**
+ * @brief function removing the node with the smallest key
+ * @warning The heap must not be empty
+ *
+ * @param H pointer to the heap
+ * @param key pointer to the key of the removed node, may be NULL
+ * @return int removed node
+ */
+int heap_pop(struct min_heap *H, int *key)
+{
+    int node = H->node[0];
+
+    if (key != NULL)
+        *key = H->key[0];
+
+    H->size--;
+    H->position[node] = HEAP_ABSENT;
+
+    if (H->size > 0)
+    {
+        H->node[0] = H->node[H->size];
+        H->key[0] = H->key[H->size];
+        H->position[H->node[0]] = 0;
+        heap_sift_down(H, 0);
+    }
+
+    return node;
+}
+
+/**
+ * @brief function getting the smallest key in the heap
+ * @warning The heap must not be empty
+ *
+ * @param H pointer to the heap
+ * @return int smallest key
+ */
+int heap_top_key(struct min_heap *H)
+{
+    return H->key[0];
+}
+
+/**
+ * @brief function removing all nodes from the heap
+ *
+ * @param H pointer to the heap
+ */
+void heap_clear(struct min_heap *H)
+{
+    for (int i = 0; i < H->size; i++)
+    {
+        H->position[H->node[i]] = HEAP_ABSENT;
+    }
+
+    H->size = 0;
+}
+
+/**
+ * @brief function freeing the heap
+ *
+ * @param H pointer to the heap
+ */
+void free_heap(struct min_heap *H)
+{
+    if (H != NULL)
+    {
+        free(H->node);
+        free(H->key);
+        free(H->position);
+        free(H);
+    }
+}
+
+#endif
@@ -0,0 +1,399 @@
+/**
+ * @file johnson.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief Johnson's reweighting, Dijkstra from every router of graphs with negative costs
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef JOHNSON_H
+#define JOHNSON_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "limits.h"
+
+#include "bellford.h"
+#include "graph.h"
+#include "heap.h"
+#include "network.h"
+#include "router.h"
+
+/*
+
+bellman_ford() is O(V * E) for every router only because costs may be
+negative. Node 0 runs one Bellman-Ford from a virtual source linked to every
+node with cost 0; its distances are potentials H with H(V) <= H(U) + cost(U, V),
+so every reweighted cost
+
+cost'(U, V) = cost(U, V) + H(U) - H(V)
+
+is non-negative and shortest paths stay the same. The potentials are broadcast
+and every router runs Dijkstra on the reweighted graph, distances are converted
+back with d(S, V) = d'(S, V) - H(S) + H(V).
+
+A negative cycle has no potentials. Node 0 prints it and all nodes return
+without writing any routing table.
+
+*/
+
+#define JOHNSON_UNREACHED (INT_MAX / 2)
+
+/**
+ * @brief structure representing the reweighted graph and the Dijkstra scratch data
+ *
+ * @param nodes number of nodes
+ * @param out outgoing edges, costs reweighted
+ * @param potential potential of every node
+ * @param heap heap of Dijkstra
+ * @param distance reweighted distances from the current source
+ * @param settled number of nodes settled by all searches
+ */
+struct johnson_engine {
+    int nodes;
+    struct adjacency *out;
+    int *potential;
+    struct min_heap *heap;
+    int *distance;
+    long settled;
+};
+
+/**
+ * @brief function printing a negative cycle found by the potential search
+ *
+ * Runs plain Bellman-Ford passes from the virtual source: a node relaxed in the
+ * last pass leads back into a cycle after nodes predecessor steps.
+ *
+ * @param A outgoing edges of the graph
+ * @param as_map array mapping node IDs to AS numbers
+ * @param potential scratch array of distances from the virtual source
+ * @param predecessor scratch array of predecessors
+ */
+void johnson_print_cycle(struct adjacency *A, const int *as_map, int *potential, int *predecessor)
+{
+    int nodes = A->nodes;
+    int last = NULL_PREDECESSOR;
+
+    for (int i = 0; i < nodes; i++)
+    {
+        potential[i] = 0;
+        predecessor[i] = NULL_PREDECESSOR;
+    }
+
+    // nodes + 1 passes, the virtual source counts as a node
+    for (int pass = 0; pass <= nodes; pass++)
+    {
+        last = NULL_PREDECESSOR;
+
+        for (int u = 0; u < nodes; u++)
+        {
+            for (int k = A->offset[u]; k < A->offset[u + 1]; k++)
+            {
+                int v = A->target[k];
+
+                if (potential[u] + A->cost[k] < potential[v])
+                {
+                    potential[v] = potential[u] + A->cost[k];
+                    predecessor[v] = u;
+                    last = v;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < nodes && last >= 0; i++)
+        last = predecessor[last];
+
+    if (last < 0)
+    {
+        printf("Graph contains a negative-weight cycle\n");
+        return;
+    }
+
+    int *cycle = (int *)malloc(sizeof(int) * (nodes + 1));
+    int length = 0;
+    int total = 0;
+    int v = last;
+
+    // Collected against the direction of the links
+    do
+    {
+        cycle[length++] = v;
+        v = predecessor[v];
+    } while (v != last);
+
+    printf("Negative cycle:");
+    for (int i = length - 1; i >= 0; i--)
+    {
+        int from = cycle[i];
+        int to = cycle[(i + length - 1) % length];
+
+        for (int k = A->offset[from]; k < A->offset[from + 1]; k++)
+        {
+            if (A->target[k] == to)
+            {
+                total += A->cost[k];
+                break;
+            }
+        }
+
+        printf(" AS %i ->", as_map[from]);
+    }
+    printf(" AS %i, cost %i\n", as_map[cycle[length - 1]], total);
+
+    free(cycle);
+}
+
+/**
+ * @brief function computing the potentials with Bellman-Ford from a virtual source, run on node 0
+ *
+ * FIFO Bellman-Ford with every node queued at distance 0. Without negative cycles
+ * no node is queued more than nodes + 1 times.
+ *
+ * @param A outgoing edges of the graph
+ * @param as_map array mapping node IDs to AS numbers
+ * @param potential array to be filled with the potentials
+ * @param relaxations pointer to the number of improving relaxations
+ * @return int 0 on success, -1 if the graph has a negative cycle
+ */
+int johnson_potentials(struct adjacency *A, const int *as_map, int *potential, long *relaxations)
+{
+    int nodes = A->nodes;
+    int *queue = (int *)malloc(sizeof(int) * (nodes + 1));
+    int *queued_times = (int *)calloc(nodes + 1, sizeof(int));
+    char *queued = (char *)malloc(nodes + 1);
+    int head = 0;
+    int length = nodes;
+    int cycle = 0;
+
+    for (int i = 0; i < nodes; i++)
+    {
+        potential[i] = 0;
+        queue[i] = i;
+        queued[i] = 1;
+        queued_times[i] = 1;
+    }
+
+    while (length > 0 && !cycle)
+    {
+        int u = queue[head];
+        head = (head + 1) % (nodes + 1);
+        length--;
+        queued[u] = 0;
+
+        for (int k = A->offset[u]; k < A->offset[u + 1] && !cycle; k++)
+        {
+            int v = A->target[k];
+            int candidate = potential[u] + A->cost[k];
+
+            if (candidate >= potential[v])
+                continue;
+
+            potential[v] = candidate;
+            (*relaxations)++;
+
+            if (queued[v])
+                continue;
+
+            if (++queued_times[v] > nodes + 1)
+            {
+                cycle = 1;
+                break;
+            }
+
+            queue[(head + length) % (nodes + 1)] = v;
+            length++;
+            queued[v] = 1;
+        }
+    }
+
+    if (cycle)
+    {
+        int *predecessor = (int *)malloc(sizeof(int) * (nodes + 1));
+        johnson_print_cycle(A, as_map, potential, predecessor);
+        free(predecessor);
+    }
+
+    free(queue);
+    free(queued_times);
+    free(queued);
+
+    return cycle ? -1 : 0;
+}
+
+/**
+ * @brief function initializing the engine from a graph and its potentials
+ *
+ * @param G pointer to the graph
+ * @param potential potentials, the engine keeps a copy
+ * @return struct johnson_engine* pointer to the engine
+ */
+struct johnson_engine *init_johnson_engine(struct graph *G, const int *potential)
+{
+    struct johnson_engine *J = (struct johnson_engine *)malloc(sizeof(struct johnson_engine));
+    int nodes = G->nodes;
+
+    J->nodes = nodes;
+    J->out = extract_adjacency(G, 0);
+    J->potential = (int *)malloc(sizeof(int) * (nodes + 1));
+    J->heap = init_heap(nodes);
+    J->distance = (int *)malloc(sizeof(int) * (nodes + 1));
+    J->settled = 0;
+
+    memcpy(J->potential, potential, sizeof(int) * nodes);
+
+    for (int u = 0; u < nodes; u++)
+    {
+        for (int k = J->out->offset[u]; k < J->out->offset[u + 1]; k++)
+            J->out->cost[k] += potential[u] - potential[J->out->target[k]];
+    }
+
+    return J;
+}
+
+/**
+ * @brief function freeing the engine
+ *
+ * @param J pointer to the engine
+ */
+void free_johnson_engine(struct johnson_engine *J)
+{
+    free_adjacency(J->out);
+    free_heap(J->heap);
+    free(J->potential);
+    free(J->distance);
+    free(J);
+}
+
+/**
+ * @brief function computing the shortest paths from a source with Dijkstra on the reweighted graph
+ *
+ * @param J pointer to the engine
+ * @param source_id ID of the source node
+ * @return struct bellman_results results in the format of bellman_ford, owned by the caller
+ */
+struct bellman_results johnson_shortest_paths(struct johnson_engine *J, int source_id)
+{
+    int nodes = J->nodes;
+    int *distance = J->distance;
+    struct adjacency *A = J->out;
+
+    struct bellman_results res;
+    res.size = nodes;
+    res.distance = (int *)malloc(sizeof(int) * nodes);
+    res.predecessor = (int *)malloc(sizeof(int) * nodes);
+
+    for (int i = 0; i < nodes; i++)
+    {
+        distance[i] = JOHNSON_UNREACHED;
+        res.predecessor[i] = NULL_PREDECESSOR;
+    }
+
+    distance[source_id] = 0;
+    heap_push(J->heap, source_id, 0);
+
+    while (J->heap->size > 0)
+    {
+        int key;
+        int u = heap_pop(J->heap, &key);
+        J->settled++;
+
+        for (int k = A->offset[u]; k < A->offset[u + 1]; k++)
+        {
+            int v = A->target[k];
+            int candidate = key + A->cost[k];
+
+            if (candidate < distance[v])
+            {
+                distance[v] = candidate;
+                res.predecessor[v] = u;
+                heap_push(J->heap, v, candidate);
+            }
+        }
+    }
+
+    for (int i = 0; i < nodes; i++)
+    {
+        if (distance[i] >= JOHNSON_UNREACHED)
+            res.distance[i] = INFINITY;
+        else
+            res.distance[i] = distance[i] - J->potential[source_id] + J->potential[i];
+    }
+
+    return res;
+}
+
+/**
+ * @brief function computing the routers of a process with Johnson's reweighting
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @return int 0 on success, -1 if the graph has a negative cycle (no routing table is written)
+ */
+int run_johnson(struct network *net, int rank, int size)
+{
+    int nodes = net->router_count;
+    int *potential = (int *)malloc(sizeof(int) * (nodes + 1));
+    int status = 0;
+    long relaxations = 0;
+    double start = MPI_Wtime();
+
+    if (rank == 0)
+    {
+        struct adjacency *A = extract_adjacency(net->netgraph, 0);
+        status = johnson_potentials(A, net->as_map, potential, &relaxations);
+        free_adjacency(A);
+    }
+
+    double reweighting = MPI_Wtime() - start;
+
+    MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (status != 0)
+    {
+        free(potential);
+        return status;
+    }
+
+    MPI_Bcast(potential, nodes, MPI_INT, 0, MPI_COMM_WORLD);
+
+    struct johnson_engine *J = init_johnson_engine(net->netgraph, potential);
+    double compute = 0;
+
+    for (int i = rank; i < nodes; i += size)
+    {
+        double begin = MPI_Wtime();
+        struct bellman_results res = johnson_shortest_paths(J, i);
+        compute += MPI_Wtime() - begin;
+
+        struct router *rtr = routing_info_from_results(net->as_map[i], net->netgraph, net->as_map, net->names[i], res);
+        describe_router(rtr);
+        free_router(rtr);
+    }
+
+    long settled;
+    double slowest;
+    MPI_Reduce(&J->settled, &settled, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&compute, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        printf("Johnson: potentials from one Bellman-Ford in %.3f s (%li relaxations)\n", reweighting, relaxations);
+        printf("Johnson: Dijkstra from %i routers, %li nodes settled, %.3f s on the slowest process\n",
+               nodes, settled, slowest);
+    }
+
+    free_johnson_engine(J);
+    free(potential);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,271 @@
+/**
+ * @file largemem.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief huge pages and NUMA placement of large arrays, TLB and remote access counters
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef LARGEMEM_H
+#define LARGEMEM_H
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stdint.h"
+#include "malloc.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/ioctl.h"
+#include "sys/syscall.h"
+#include "linux/perf_event.h"
+
+/*
+
+Arrays of at least LARGE_PAGE bytes (cost matrix, edge lists, adjacency, the
+shared arrays of the pull engine) are advised right after allocation, before
+they are first touched. With --huge-pages they get MADV_HUGEPAGE, so
+transparent huge pages back them even when THP is in madvise mode and the
+relaxation loops need far fewer TLB entries. mallopt fixes the mmap threshold
+so every such array is a fresh mapping of its own and free() still works.
+
+Placement uses mbind directly (no libnuma):
+
+--numa=interleave  large arrays are spread page by page over all nodes, for
+                   threads of one process running on several sockets
+--numa=replicate   every process keeps its own copy of the read only graph
+                   (it already does, each one receives the broadcast) and the
+                   copy is bound (MPOL_BIND) to the node of the CPU the process
+                   runs on when it is allocated, so processes should be pinned
+
+Per thread arrays of the pull engine are placed by first touch, every thread
+writes its own range before the first source. --memory-stats adds dTLB load
+misses and loads served by a remote node (perf_event_open, user space only) and
+the amount of anonymous memory in huge pages, so runs with and without the
+flags can be compared.
+
+*/
+
+#define LARGE_PAGE (2UL << 20)
+#define LARGE_SMALL_PAGE 4096UL
+
+#define LARGE_FIRST_TOUCH 0
+#define LARGE_INTERLEAVE 1
+#define LARGE_REPLICATE 2
+
+// From linux/mempolicy.h, not always installed
+#define LARGE_MPOL_BIND 2
+#define LARGE_MPOL_INTERLEAVE 3
+#define LARGE_MPOL_MF_MOVE (1 << 1)
+
+/**
+ * @brief structure representing the configuration and counters of the large array layer
+ *
+ * @param huge 1 to back large arrays with huge pages
+ * @param placement LARGE_FIRST_TOUCH, LARGE_INTERLEAVE or LARGE_REPLICATE
+ * @param node_mask online NUMA nodes
+ * @param node_count number of online NUMA nodes
+ * @param arrays number of advised arrays
+ * @param bytes number of advised bytes
+ * @param failed number of madvise or mbind calls the kernel refused
+ * @param tlb_fd perf counter of dTLB load misses, -1 if not available
+ * @param remote_fd perf counter of loads from a remote node, -1 if not available
+ */
+struct large_memory {
+    int huge;
+    int placement;
+    unsigned long node_mask;
+    int node_count;
+    long arrays;
+    long bytes;
+    long failed;
+    int tlb_fd;
+    int remote_fd;
+};
+
+static struct large_memory large_memory = {0, LARGE_FIRST_TOUCH, 1, 1, 0, 0, 0, -1, -1};
+
+/**
+ * @brief function reading the online NUMA nodes, for example "0-1" or "0,2-3"
+ *
+ * @param count pointer to the number of nodes
+ * @return unsigned long mask of the nodes, node 0 if unknown
+ */
+unsigned long large_online_nodes(int *count)
+{
+    unsigned long mask = 0;
+    char line[256];
+    FILE *fp = fopen("/sys/devices/system/node/online", "r");
+
+    if (fp != NULL && fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *token = strtok(line, ",\n");
+        while (token != NULL)
+        {
+            int first, last;
+            int parsed = sscanf(token, "%i-%i", &first, &last);
+
+            if (parsed == 1)
+                last = first;
+
+            for (int n = first; parsed >= 1 && n <= last && n < (int)(8 * sizeof(unsigned long)); n++)
+                mask |= 1UL << n;
+
+            token = strtok(NULL, ",\n");
+        }
+    }
+
+    if (fp != NULL)
+        fclose(fp);
+
+    if (mask == 0)
+        mask = 1;
+
+    *count = __builtin_popcountl(mask);
+    return mask;
+}
+
+/**
+ * @brief function configuring the layer, must be called before the large arrays are allocated
+ *
+ * @param huge 1 to back large arrays with huge pages
+ * @param placement LARGE_FIRST_TOUCH, LARGE_INTERLEAVE or LARGE_REPLICATE
+ */
+void large_memory_configure(int huge, int placement)
+{
+    large_memory.huge = huge;
+    large_memory.placement = placement;
+    large_memory.node_mask = large_online_nodes(&large_memory.node_count);
+
+    // Large arrays always get their own untouched mapping
+    if (huge || placement != LARGE_FIRST_TOUCH)
+        mallopt(M_MMAP_THRESHOLD, LARGE_PAGE);
+}
+
+/**
+ * @brief function advising a freshly allocated array, before its pages are first touched
+ *
+ * @param ptr start of the array
+ * @param bytes size of the array
+ */
+void large_advise(void *ptr, size_t bytes)
+{
+    if (ptr == NULL || bytes < LARGE_PAGE || (!large_memory.huge && large_memory.placement == LARGE_FIRST_TOUCH))
+        return;
+
+    // Only whole pages inside the array, the allocator header stays untouched
+    uintptr_t start = ((uintptr_t)ptr + LARGE_SMALL_PAGE - 1) & ~(LARGE_SMALL_PAGE - 1);
+    uintptr_t end = ((uintptr_t)ptr + bytes) & ~(LARGE_SMALL_PAGE - 1);
+
+    if (end <= start)
+        return;
+
+    if (large_memory.huge && madvise((void *)start, end - start, MADV_HUGEPAGE) != 0)
+        large_memory.failed++;
+
+    if (large_memory.placement != LARGE_FIRST_TOUCH)
+    {
+        int interleave = large_memory.placement == LARGE_INTERLEAVE;
+        unsigned long mask = large_memory.node_mask;
+        unsigned cpu, node;
+
+        // A replica goes to the node the process runs on now, not wherever it is touched later
+        if (!interleave)
+        {
+            if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node < 8 * sizeof(unsigned long))
+                mask = 1UL << node;
+            else
+                mask = 0;
+        }
+
+        long result = mask == 0 ? -1 :
+                      syscall(SYS_mbind, (void *)start, end - start, interleave ? LARGE_MPOL_INTERLEAVE : LARGE_MPOL_BIND,
+                              &mask, 8 * sizeof(unsigned long) + 1, LARGE_MPOL_MF_MOVE);
+        if (result != 0)
+            large_memory.failed++;
+    }
+
+    large_memory.arrays++;
+    large_memory.bytes += end - start;
+}
+
+/**
+ * @brief function opening a user space hardware cache counter of the calling process
+ *
+ * @param cache PERF_COUNT_HW_CACHE_DTLB or PERF_COUNT_HW_CACHE_NODE
+ * @return int descriptor of the counter, -1 if not available
+ */
+int large_open_counter(int cache)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd >= 0)
+    {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    return fd;
+}
+
+/**
+ * @brief function starting the dTLB miss and remote node counters
+ */
+void large_counters_start(void)
+{
+    large_memory.tlb_fd = large_open_counter(PERF_COUNT_HW_CACHE_DTLB);
+    large_memory.remote_fd = large_open_counter(PERF_COUNT_HW_CACHE_NODE);
+}
+
+/**
+ * @brief function reading a counter
+ *
+ * @param fd descriptor of the counter
+ * @return long value of the counter, -1 if not available
+ */
+long large_read_counter(int fd)
+{
+    long long value;
+
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value))
+        return -1;
+
+    return (long)value;
+}
+
+/**
+ * @brief function reading the anonymous memory of the process backed by huge pages
+ *
+ * @return long kilobytes in huge pages, -1 if not available
+ */
+long large_huge_kb(void)
+{
+    FILE *fp = fopen("/proc/self/smaps_rollup", "r");
+    char line[256];
+    long kb = -1;
+
+    while (fp != NULL && fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (sscanf(line, "AnonHugePages: %li kB", &kb) == 1)
+            break;
+    }
+
+    if (fp != NULL)
+        fclose(fp);
+
+    return kb;
+}
+
+#endif
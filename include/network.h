@@ -0,0 +1,172 @@
+/**
+ * @file network.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief distribution of the parsed network to all MPI processes
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stdint.h"
+
+#include "graph.h"
+
+/**
+ * @brief structure representing the network known to every process
+ *
+ * @param router_count number of routers in the network
+ * @param as_map array mapping node IDs to AS numbers
+ * @param names_length array of lengths of router names
+ * @param names array of names of the routers
+ * @param netgraph pointer to the graph structure
+ */
+struct network {
+    int router_count;
+    int *as_map;
+    int *names_length;
+    char **names;
+    struct graph *netgraph;
+};
+
+/**
+ * @brief function parsing the configuration on node 0 and broadcasting it to all nodes
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param filename name of the configuration file (only used on node 0)
+ * @param rank rank of the calling process
+ * @return struct network* network shared by all processes
+ */
+struct network *broadcast_network(const char *filename, int rank)
+{
+    struct network *net = (struct network *)malloc(sizeof(struct network));
+
+    net->as_map = NULL;
+    net->names_length = NULL;
+    net->names = NULL;
+    net->netgraph = NULL;
+
+    if (rank == 0)
+    {
+        struct parsing_output *temp = data_from_file(filename);
+
+        net->router_count = temp->node_amount;
+        net->as_map = temp->as_map;
+        net->names = temp->names;
+
+        net->names_length = malloc(sizeof(int) * net->router_count);
+
+        for (int i = 0; i < net->router_count; i++)
+        {
+            net->names_length[i] = strlen(net->names[i]);
+        }
+
+        net->netgraph = temp->netgraph;
+        free(temp);
+    }
+
+    // Workery muszą wiedzieć ile jest danych do alokacji
+    // addr, count, size, node_id from, comms
+    MPI_Bcast(&net->router_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int router_count = net->router_count;
+
+    // Tylko zwykłe workery, nie mają gotowych danych
+    if (net->as_map == NULL)
+    {
+        net->as_map = malloc(sizeof(int) * router_count);
+        net->names_length = malloc(sizeof(int) * router_count);
+        net->names = malloc(sizeof(char*) * router_count);
+    }
+
+    // Prześlij informacje o rozmiarach nazw oraz mapowanie AS
+    MPI_Bcast(net->as_map, router_count, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(net->names_length, router_count, MPI_INT, 0, MPI_COMM_WORLD);
+
+    // Przygotowanie miejsca w workerach na nazwy
+    if (rank != 0)
+    {
+        for (int i = 0; i < router_count; i++)
+        {
+            net->names[i] = malloc(sizeof(char) * net->names_length[i] + 1);
+        }
+    }
+
+    // Prześlij nazwy
+    for (int i = 0; i < router_count; i++)
+    {
+        MPI_Bcast(net->names[i], net->names_length[i] + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
+    }
+
+    // Prześlij graf
+
+    if (net->netgraph == NULL)
+    {
+        net->netgraph = init_graph(router_count);
+    }
+
+    MPI_Bcast(net->netgraph->costs, router_count * router_count, MPI_INT, 0, MPI_COMM_WORLD);
+    net->netgraph->nodes = router_count;
+
+    return net;
+}
+
+/**
+ * @brief function freeing the network
+ *
+ * @param net pointer to the network
+ */
+void free_network(struct network *net)
+{
+    if (net == NULL)
+    {
+        return;
+    }
+
+    free_graph(net->netgraph);
+
+    for (int i = 0; i < net->router_count; i++)
+    {
+        free(net->names[i]);
+    }
+
+    free(net->names);
+    free(net->as_map);
+    free(net->names_length);
+    free(net);
+}
+
+/**
+ * @brief function hashing the routers and link costs of the network (FNV-1a)
+ *
+ * @param net pointer to the network
+ * @return uint64_t fingerprint of the topology
+ */
+uint64_t network_fingerprint(struct network *net)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    int nodes = net->router_count;
+
+    const unsigned char *bytes = (const unsigned char *)&nodes;
+    for (size_t b = 0; b < sizeof(int); b++)
+        hash = (hash ^ bytes[b]) * 1099511628211ULL;
+
+    bytes = (const unsigned char *)net->as_map;
+    for (size_t b = 0; b < sizeof(int) * nodes; b++)
+        hash = (hash ^ bytes[b]) * 1099511628211ULL;
+
+    bytes = (const unsigned char *)net->netgraph->costs;
+    for (size_t b = 0; b < sizeof(int) * (size_t)nodes * nodes; b++)
+        hash = (hash ^ bytes[b]) * 1099511628211ULL;
+
+    return hash;
+}
+
+#endif
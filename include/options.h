@@ -0,0 +1,264 @@
+/**
+ * @file options.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief command line options of the main program
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "ctype.h"
+
+#include "largemem.h"
+
+#define PULL_JACOBI 0
+#define PULL_GAUSS_SEIDEL 1
+
+/**
+ * @brief structure representing the command line options
+ *
+ * @param config_file name of the routing configuration file
+ * @param serve_socket path of the Unix socket to serve route queries on, NULL if not serving
+ * @param serve_threads number of query threads of the route server
+ * @param warm_start 1 to seed every router's shortest paths from a computed peer
+ * @param arena_batch routers computed between two arena resets, 0 to use the heap
+ * @param memory_stats 1 to print allocation counts and peak RSS at the end
+ * @param distance_vector 1 to run the asynchronous distance-vector protocol between processes
+ * @param what_if name of a scenario file to compare against the baseline, NULL if not used
+ * @param query_file name of a file with AS pairs to find paths for, NULL if not used
+ * @param pull_threads threads per process of the pull engine, 0 if not used
+ * @param pull_mode PULL_JACOBI or PULL_GAUSS_SEIDEL
+ * @param out_of_core name of the edge file to stream the graph from, NULL to keep the graph in memory
+ * @param ch_build name of the contraction hierarchy index to be built, NULL if not building
+ * @param ch_index name of a built index to answer --query with, NULL if not used
+ * @param checkpoint_interval seconds between checkpoints of finished routers, -1 without checkpoints
+ * @param resume 1 to skip the routers of earlier checkpoints
+ * @param johnson 1 to reweight negative costs once and run Dijkstra from every router
+ * @param clusters 1 to combine intra-cluster tables with a boundary overlay
+ * @param cluster_size maximum number of routers of a cluster, 0 for the default
+ * @param huge_pages 1 to back large arrays with transparent huge pages
+ * @param numa_placement placement of large arrays, LARGE_FIRST_TOUCH, LARGE_INTERLEAVE or LARGE_REPLICATE
+ */
+struct run_options {
+    const char *config_file;
+    const char *serve_socket;
+    int serve_threads;
+    int warm_start;
+    int arena_batch;
+    int memory_stats;
+    int distance_vector;
+    const char *what_if;
+    const char *query_file;
+    int pull_threads;
+    int pull_mode;
+    const char *out_of_core;
+    const char *ch_build;
+    const char *ch_index;
+    int checkpoint_interval;
+    int resume;
+    int johnson;
+    int clusters;
+    int cluster_size;
+    int huge_pages;
+    int numa_placement;
+};
+
+/**
+ * @brief function printing the usage of the main program
+ *
+ * @param program name of the program
+ */
+void print_usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s <config file> [options]\n", program);
+    fprintf(stderr, "  --serve <socket>      keep all routing tables and answer queries on a Unix socket\n");
+    fprintf(stderr, "  --serve-threads <n>   number of query threads of the server (default 4)\n");
+    fprintf(stderr, "  --warm-start          order routers along peers and reuse the previous router's distances\n");
+    fprintf(stderr, "  --arena [batch]       take router and scratch memory from an arena reset every batch routers (default 64)\n");
+    fprintf(stderr, "  --memory-stats        print allocation counts and peak RSS\n");
+    fprintf(stderr, "  --distance-vector     exchange distance vectors only between processes owning peer routers\n");
+    fprintf(stderr, "  --what-if <file>      compute the baseline once and diff every link failure or cost change scenario\n");
+    fprintf(stderr, "  --query <file>        find the path of every AS pair in the file instead of full tables\n");
+    fprintf(stderr, "  --pull[=jacobi] [n]   threaded Bellman-Ford pulling over incoming edges, n threads per process (default 4)\n");
+    fprintf(stderr, "  --out-of-core <file>  convert the configuration to an edge file and stream it instead of a cost matrix\n");
+    fprintf(stderr, "  --ch <index>          build a contraction hierarchy and save it, answer --query with it\n");
+    fprintf(stderr, "  --ch-index <index>    answer --query with a saved contraction hierarchy\n");
+    fprintf(stderr, "  --checkpoint [s]      record finished routers every s >= 0 seconds, 0 after every router (default 60)\n");
+    fprintf(stderr, "  --resume              skip routers of earlier checkpoints, spread the rest over the processes\n");
+    fprintf(stderr, "  --johnson             one Bellman-Ford for potentials, then Dijkstra from every router\n");
+    fprintf(stderr, "  --clusters [n]        tables inside clusters of at most n routers joined by a boundary overlay\n");
+    fprintf(stderr, "  --huge-pages          back the graph, edge and distance arrays with huge pages\n");
+    fprintf(stderr, "  --numa=interleave     spread shared arrays over all NUMA nodes\n");
+    fprintf(stderr, "  --numa=replicate      keep the graph copy of every process on its own NUMA node\n");
+}
+
+/**
+ * @brief function parsing the command line options
+ * @warning Exits the program on malformed options
+ *
+ * @param argc argument count
+ * @param argv argument values
+ * @return struct run_options parsed options
+ */
+struct run_options parse_options(int argc, char **argv)
+{
+    struct run_options opts;
+    opts.config_file = NULL;
+    opts.serve_socket = NULL;
+    opts.serve_threads = 4;
+    opts.warm_start = 0;
+    opts.arena_batch = 0;
+    opts.memory_stats = 0;
+    opts.distance_vector = 0;
+    opts.what_if = NULL;
+    opts.query_file = NULL;
+    opts.pull_threads = 0;
+    opts.pull_mode = PULL_GAUSS_SEIDEL;
+    opts.out_of_core = NULL;
+    opts.ch_build = NULL;
+    opts.ch_index = NULL;
+    opts.checkpoint_interval = -1;
+    opts.resume = 0;
+    opts.johnson = 0;
+    opts.clusters = 0;
+    opts.cluster_size = 0;
+    opts.huge_pages = 0;
+    opts.numa_placement = LARGE_FIRST_TOUCH;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+        {
+            opts.serve_socket = argv[++i];
+        }
+        else if (strcmp(argv[i], "--serve-threads") == 0 && i + 1 < argc)
+        {
+            opts.serve_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--warm-start") == 0)
+        {
+            opts.warm_start = 1;
+        }
+        else if (strcmp(argv[i], "--arena") == 0)
+        {
+            opts.arena_batch = 64;
+            opts.memory_stats = 1;
+
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0)
+                opts.arena_batch = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--memory-stats") == 0)
+        {
+            opts.memory_stats = 1;
+        }
+        else if (strcmp(argv[i], "--distance-vector") == 0)
+        {
+            opts.distance_vector = 1;
+        }
+        else if (strcmp(argv[i], "--what-if") == 0 && i + 1 < argc)
+        {
+            opts.what_if = argv[++i];
+        }
+        else if (strcmp(argv[i], "--query") == 0 && i + 1 < argc)
+        {
+            opts.query_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--pull") == 0 || strcmp(argv[i], "--pull=jacobi") == 0)
+        {
+            opts.pull_mode = argv[i][6] == '=' ? PULL_JACOBI : PULL_GAUSS_SEIDEL;
+            opts.pull_threads = 4;
+
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0)
+                opts.pull_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--out-of-core") == 0 && i + 1 < argc)
+        {
+            opts.out_of_core = argv[++i];
+        }
+        else if (strcmp(argv[i], "--ch") == 0 && i + 1 < argc)
+        {
+            opts.ch_build = argv[++i];
+        }
+        else if (strcmp(argv[i], "--ch-index") == 0 && i + 1 < argc)
+        {
+            opts.ch_index = argv[++i];
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0)
+        {
+            opts.checkpoint_interval = 60;
+
+            // 0 is a valid interval, so only a number is taken as the argument
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+                opts.checkpoint_interval = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--resume") == 0)
+        {
+            opts.resume = 1;
+        }
+        else if (strcmp(argv[i], "--johnson") == 0)
+        {
+            opts.johnson = 1;
+        }
+        else if (strcmp(argv[i], "--huge-pages") == 0)
+        {
+            opts.huge_pages = 1;
+        }
+        else if (strcmp(argv[i], "--numa=interleave") == 0)
+        {
+            opts.numa_placement = LARGE_INTERLEAVE;
+        }
+        else if (strcmp(argv[i], "--numa=replicate") == 0)
+        {
+            opts.numa_placement = LARGE_REPLICATE;
+        }
+        else if (strcmp(argv[i], "--clusters") == 0)
+        {
+            opts.clusters = 1;
+
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0)
+                opts.cluster_size = atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && opts.config_file == NULL)
+        {
+            opts.config_file = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (opts.resume && opts.checkpoint_interval < 0)
+        opts.checkpoint_interval = 60;
+
+    // Any other mode takes the routers over and would silently recompute everything
+    int other_mode = opts.serve_socket != NULL || opts.distance_vector || opts.ch_build != NULL ||
+                     opts.ch_index != NULL || opts.query_file != NULL || opts.what_if != NULL ||
+                     opts.pull_threads > 0 || opts.out_of_core != NULL || opts.johnson || opts.warm_start ||
+                     opts.clusters || opts.arena_batch > 0;
+
+    if (opts.checkpoint_interval >= 0 && other_mode)
+    {
+        fprintf(stderr, "--checkpoint and --resume only work with the default computation of routers\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (opts.config_file == NULL || opts.serve_threads < 1)
+    {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    return opts;
+}
+
+#endif
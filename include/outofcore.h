@@ -0,0 +1,537 @@
+/**
+ * @file outofcore.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief out-of-core Bellman-Ford streaming the edges from a memory-mapped file
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef OUTOFCORE_H
+#define OUTOFCORE_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "limits.h"
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+
+#include "bellford.h"
+#include "graph.h"
+#include "router.h"
+
+/*
+
+init_graph() keeps a nodes x nodes cost matrix on every process, so the network
+has to fit in memory of each of them. In this mode node 0 converts the
+configuration into an edge file without building the matrix and every process
+maps it:
+
+EDGE FILE [header | offsets (long, nodes + 1) | edges {target, cost} sorted by source]
+
+The file has to be visible to all processes (shared or local file system).
+Only distances, predecessors, frontier flags and offsets stay resident. Every
+pass of Bellman-Ford reads the sources in file order, so the edges are streamed
+sequentially: the window ahead is requested with MADV_WILLNEED, the window
+behind is dropped with MADV_DONTNEED and distances of targets are prefetched.
+
+*/
+
+#define OOC_MAGIC "BFEDGES1"
+#define OOC_WINDOW (8L << 20)
+#define OOC_PREFETCH 16
+#define OOC_UNREACHED (INT_MAX / 2)
+
+/**
+ * @brief structure representing the header of an edge file
+ *
+ * @param magic OOC_MAGIC
+ * @param nodes number of nodes
+ * @param edges number of edges
+ */
+struct ooc_header {
+    char magic[8];
+    long nodes;
+    long edges;
+};
+
+/**
+ * @brief structure representing an edge in the edge file, the source is given by the offsets
+ *
+ * @param target node ID of the other end
+ * @param cost cost of the edge
+ */
+struct ooc_edge {
+    int target;
+    int cost;
+};
+
+/**
+ * @brief structure representing the mapped edge file and the resident state
+ *
+ * @param nodes number of nodes
+ * @param edges number of edges
+ * @param offset first edge of every source, nodes + 1 entries
+ * @param edge mapped edges
+ * @param map start of the mapping
+ * @param map_size size of the mapping in bytes
+ * @param distance distances from the current source
+ * @param predecessor predecessors on the shortest paths
+ * @param active 1 for nodes whose distance changed since their edges were read
+ * @param streamed number of edge bytes read so far
+ * @param passes number of passes over the file so far
+ */
+struct ooc_graph {
+    int nodes;
+    long edges;
+    long *offset;
+    struct ooc_edge *edge;
+    char *map;
+    size_t map_size;
+    int *distance;
+    int *predecessor;
+    char *active;
+    long streamed;
+    long passes;
+};
+
+/**
+ * @brief structure representing an AS number and its node ID, sorted for lookups
+ *
+ * @param as_number AS number
+ * @param node node ID
+ */
+struct ooc_as {
+    int as_number;
+    int node;
+};
+
+/**
+ * @brief function comparing two struct ooc_as by AS number
+ */
+int compare_ooc_as(const void *a, const void *b)
+{
+    int x = ((const struct ooc_as *)a)->as_number;
+    int y = ((const struct ooc_as *)b)->as_number;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief function converting a configuration file into an edge file in two passes
+ * @warning Exits the program if a file cannot be opened
+ *
+ * Node IDs follow the order of ROUTER lines, peers with an unknown AS are skipped.
+ *
+ * @param config_file name of the configuration file
+ * @param edge_file name of the edge file to be written
+ * @param count pointer to be filled with the number of routers
+ * @param as_map pointer to be filled with the array mapping node IDs to AS numbers
+ * @param names pointer to be filled with the array of router names
+ * @return long number of edges written
+ */
+long ooc_convert(const char *config_file, const char *edge_file, int *count, int **as_map, char ***names)
+{
+    FILE *in = fopen(config_file, "r");
+    if (in == NULL)
+    {
+        fprintf(stderr, "Cannot open %s\n", config_file);
+        exit(EXIT_FAILURE);
+    }
+
+    char *line = NULL;
+    size_t len = 0;
+    char name[256];
+    int as_number, cost;
+    int capacity = 1024;
+    int nodes = 0;
+
+    *as_map = (int *)malloc(sizeof(int) * capacity);
+    *names = (char **)malloc(sizeof(char *) * capacity);
+
+    // First pass: only the routers
+    while (getline(&line, &len, in) != -1)
+    {
+        if (sscanf(line, " ROUTER %255s %i", name, &as_number) != 2)
+            continue;
+
+        if (nodes == capacity)
+        {
+            capacity *= 2;
+            *as_map = (int *)realloc(*as_map, sizeof(int) * capacity);
+            *names = (char **)realloc(*names, sizeof(char *) * capacity);
+        }
+
+        (*as_map)[nodes] = as_number;
+        (*names)[nodes] = (char *)malloc(strlen(name) + 1);
+        strcpy((*names)[nodes], name);
+        nodes++;
+    }
+
+    struct ooc_as *sorted = (struct ooc_as *)malloc(sizeof(struct ooc_as) * (nodes + 1));
+    for (int i = 0; i < nodes; i++)
+    {
+        sorted[i].as_number = (*as_map)[i];
+        sorted[i].node = i;
+    }
+    qsort(sorted, nodes, sizeof(struct ooc_as), compare_ooc_as);
+
+    FILE *out = fopen(edge_file, "w+b");
+    if (out == NULL)
+    {
+        fprintf(stderr, "Cannot create %s\n", edge_file);
+        exit(EXIT_FAILURE);
+    }
+
+    struct ooc_header header;
+    memcpy(header.magic, OOC_MAGIC, 8);
+    header.nodes = nodes;
+    header.edges = 0;
+
+    long *offset = (long *)calloc(nodes + 1, sizeof(long));
+
+    // Offsets are known only at the end, leave room for them
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(offset, sizeof(long), nodes + 1, out);
+
+    // Second pass: peers of every router follow its ROUTER line, so edges come out sorted by source
+    rewind(in);
+    int source = -1;
+    while (getline(&line, &len, in) != -1)
+    {
+        if (sscanf(line, " ROUTER %255s %i", name, &as_number) == 2)
+        {
+            source++;
+            offset[source] = header.edges;
+            continue;
+        }
+
+        if (source < 0 || sscanf(line, " PEER %i %i", &as_number, &cost) != 2)
+            continue;
+
+        struct ooc_as key = {as_number, 0};
+        struct ooc_as *found = (struct ooc_as *)bsearch(&key, sorted, nodes, sizeof(struct ooc_as), compare_ooc_as);
+        if (found == NULL)
+            continue;
+
+        struct ooc_edge e = {found->node, cost};
+        fwrite(&e, sizeof(e), 1, out);
+        header.edges++;
+    }
+
+    for (int i = source + 1; i <= nodes; i++)
+        offset[i] = header.edges;
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(offset, sizeof(long), nodes + 1, out);
+    fclose(out);
+    fclose(in);
+
+    free(line);
+    free(offset);
+    free(sorted);
+
+    *count = nodes;
+    return header.edges;
+}
+
+/**
+ * @brief function mapping an edge file
+ * @warning Exits the program if the file is missing or malformed
+ *
+ * @param edge_file name of the edge file
+ * @return struct ooc_graph* pointer to the mapped graph
+ */
+struct ooc_graph *ooc_open(const char *edge_file)
+{
+    int fd = open(edge_file, O_RDONLY);
+    struct stat st;
+    struct ooc_header header;
+
+    if (fd < 0 || fstat(fd, &st) != 0 || read(fd, &header, sizeof(header)) != sizeof(header) ||
+        memcmp(header.magic, OOC_MAGIC, 8) != 0)
+    {
+        fprintf(stderr, "Cannot read the edge file %s\n", edge_file);
+        exit(EXIT_FAILURE);
+    }
+
+    struct ooc_graph *G = (struct ooc_graph *)calloc(1, sizeof(struct ooc_graph));
+    int nodes = (int)header.nodes;
+
+    G->nodes = nodes;
+    G->edges = header.edges;
+    G->map_size = st.st_size;
+    G->map = (char *)mmap(NULL, G->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (G->map == MAP_FAILED)
+    {
+        fprintf(stderr, "Cannot map the edge file %s\n", edge_file);
+        exit(EXIT_FAILURE);
+    }
+
+    madvise(G->map, G->map_size, MADV_SEQUENTIAL);
+
+    // Offsets are read on every pass, keep a resident copy
+    G->offset = (long *)malloc(sizeof(long) * (nodes + 1));
+    memcpy(G->offset, G->map + sizeof(header), sizeof(long) * (nodes + 1));
+    G->edge = (struct ooc_edge *)(G->map + sizeof(header) + sizeof(long) * (nodes + 1));
+
+    G->distance = (int *)malloc(sizeof(int) * (nodes + 1));
+    G->predecessor = (int *)malloc(sizeof(int) * (nodes + 1));
+    G->active = (char *)malloc(nodes + 1);
+
+    return G;
+}
+
+/**
+ * @brief function unmapping the edge file and freeing the resident state
+ *
+ * @param G pointer to the mapped graph
+ */
+void ooc_close(struct ooc_graph *G)
+{
+    munmap(G->map, G->map_size);
+    free(G->offset);
+    free(G->distance);
+    free(G->predecessor);
+    free(G->active);
+    free(G);
+}
+
+/**
+ * @brief function giving the kernel hints for the window of the edge file around a position
+ *
+ * @param G pointer to the mapped graph
+ * @param window index of the window being read
+ */
+void ooc_advise(struct ooc_graph *G, long window)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    long start = (window + 1) * OOC_WINDOW;
+
+    if (start < (long)G->map_size)
+    {
+        long length = OOC_WINDOW;
+        if (start + length > (long)G->map_size)
+            length = G->map_size - start;
+
+        madvise(G->map + start, length, MADV_WILLNEED);
+    }
+
+    // The window before the previous one will not be read until the next pass
+    if (window >= 2)
+    {
+        long behind = (window - 2) * OOC_WINDOW / page * page;
+        madvise(G->map + behind, OOC_WINDOW, MADV_DONTNEED);
+    }
+}
+
+/**
+ * @brief function computing the shortest paths from a source, streaming the edge file once per pass
+ *
+ * Nodes are relaxed in file order as soon as they are read, a pass skips the
+ * edges of nodes that did not change since their last read. Without negative
+ * cycles the passes stop after at most nodes - 1.
+ *
+ * @param G pointer to the mapped graph
+ * @param source_id ID of the source node
+ * @return struct bellman_results results in the format of bellman_ford, owned by the caller
+ */
+struct bellman_results ooc_bellman_ford(struct ooc_graph *G, int source_id)
+{
+    int nodes = G->nodes;
+    int *distance = G->distance;
+    int *predecessor = G->predecessor;
+    char *active = G->active;
+    long edges_start = (char *)G->edge - G->map;
+
+    for (int i = 0; i < nodes; i++)
+    {
+        distance[i] = OOC_UNREACHED;
+        predecessor[i] = NULL_PREDECESSOR;
+        active[i] = 0;
+    }
+
+    distance[source_id] = 0;
+    active[source_id] = 1;
+
+    int changed = 1;
+    int pass = 0;
+
+    while (changed)
+    {
+        if (pass++ == nodes)
+        {
+            printf("Graph contains a negative-weight cycle\n");
+            break;
+        }
+
+        changed = 0;
+        long window = -1;
+
+        for (int u = 0; u < nodes; u++)
+        {
+            if (!active[u])
+                continue;
+
+            active[u] = 0;
+            long first = G->offset[u];
+            long last = G->offset[u + 1];
+            long position = edges_start + first * (long)sizeof(struct ooc_edge);
+
+            if (position / OOC_WINDOW != window)
+            {
+                window = position / OOC_WINDOW;
+                ooc_advise(G, window);
+            }
+
+            const struct ooc_edge *e = G->edge;
+            int du = distance[u];
+
+            for (long k = first; k < last; k++)
+            {
+                if (k + OOC_PREFETCH < last)
+                    __builtin_prefetch(&distance[e[k + OOC_PREFETCH].target], 1);
+
+                int v = e[k].target;
+                int candidate = du + e[k].cost;
+
+                if (candidate < distance[v])
+                {
+                    distance[v] = candidate;
+                    predecessor[v] = u;
+                    active[v] = 1;
+                    changed = 1;
+                }
+            }
+
+            G->streamed += (last - first) * (long)sizeof(struct ooc_edge);
+        }
+
+        // Start the next pass from the beginning of the file
+        madvise(G->map, OOC_WINDOW < (long)G->map_size ? OOC_WINDOW : G->map_size, MADV_WILLNEED);
+    }
+
+    G->passes += pass;
+
+    struct bellman_results res;
+    res.size = nodes;
+    res.distance = (int *)malloc(sizeof(int) * nodes);
+    res.predecessor = (int *)malloc(sizeof(int) * nodes);
+
+    for (int i = 0; i < nodes; i++)
+    {
+        res.distance[i] = distance[i] >= OOC_UNREACHED ? INFINITY : distance[i];
+    }
+    memcpy(res.predecessor, predecessor, sizeof(int) * nodes);
+
+    return res;
+}
+
+/**
+ * @brief function converting the configuration on node 0, broadcasting the routers and computing them from the edge file
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param config_file name of the configuration file (only used on node 0)
+ * @param edge_file name of the edge file, written by node 0 and mapped by all nodes
+ * @param rank rank of the calling process
+ * @param size number of processes
+ */
+void run_out_of_core(const char *config_file, const char *edge_file, int rank, int size)
+{
+    int router_count = 0;
+    int *as_map = NULL;
+    char **names = NULL;
+    double convert = MPI_Wtime();
+
+    if (rank == 0)
+    {
+        long edges = ooc_convert(config_file, edge_file, &router_count, &as_map, &names);
+        printf("Out of core: %i routers, %li edges written to %s in %.3f s\n",
+               router_count, edges, edge_file, MPI_Wtime() - convert);
+    }
+
+    MPI_Bcast(&router_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int *names_length = (int *)malloc(sizeof(int) * router_count);
+
+    if (rank != 0)
+    {
+        as_map = (int *)malloc(sizeof(int) * router_count);
+        names = (char **)malloc(sizeof(char *) * router_count);
+    }
+    else
+    {
+        for (int i = 0; i < router_count; i++)
+            names_length[i] = strlen(names[i]);
+    }
+
+    MPI_Bcast(as_map, router_count, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(names_length, router_count, MPI_INT, 0, MPI_COMM_WORLD);
+
+    for (int i = 0; i < router_count; i++)
+    {
+        if (rank != 0)
+            names[i] = (char *)malloc(names_length[i] + 1);
+
+        MPI_Bcast(names[i], names_length[i] + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
+    }
+
+    // The edge file is complete once node 0 gets here
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    struct ooc_graph *G = ooc_open(edge_file);
+
+    // Routers only need the number of nodes of the graph
+    struct graph shape;
+    shape.nodes = router_count;
+    shape.costs = NULL;
+
+    double compute = 0;
+
+    for (int i = rank; i < router_count; i += size)
+    {
+        double start = MPI_Wtime();
+        struct bellman_results res = ooc_bellman_ford(G, i);
+        compute += MPI_Wtime() - start;
+
+        struct router *rtr = routing_info_from_results(as_map[i], &shape, as_map, names[i], res);
+        describe_router(rtr);
+        free_router(rtr);
+    }
+
+    long resident = (long)router_count * (2 * sizeof(int) + 1 + sizeof(long) + sizeof(int));
+    long local[3] = {G->streamed, G->passes, resident};
+    long total[3];
+    double slowest;
+
+    MPI_Reduce(local, total, 3, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&compute, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        printf("Out of core: %.1f passes per router, %.1f MB of edges streamed, %.1f MB/s on the slowest process\n",
+               router_count > 0 ? (double)total[1] / router_count : 0.0, total[0] / 1e6,
+               slowest > 0 ? total[0] / 1e6 / size / slowest : 0.0);
+        printf("Out of core: %li kB resident per process instead of a %li kB cost matrix\n",
+               resident / 1024, (long)router_count * router_count * (long)sizeof(int) / 1024);
+    }
+
+    ooc_close(G);
+
+    for (int i = 0; i < router_count; i++)
+        free(names[i]);
+
+    free(names);
+    free(names_length);
+    free(as_map);
+}
+
+#endif
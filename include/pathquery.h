@@ -0,0 +1,663 @@
+/**
+ * @file pathquery.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief point-to-point path queries answered by bidirectional Dijkstra instead of full tables
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef PATHQUERY_H
+#define PATHQUERY_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "limits.h"
+
+#include "bellford.h"
+#include "graph.h"
+#include "heap.h"
+#include "network.h"
+#include "router.h"
+
+/*
+
+Query file, one pair of AS numbers per line, # starts a comment:
+
+10 40
+20 30
+
+With non-negative costs a query grows a forward search from the source and a
+backward search from the destination, always the side with the smaller key.
+It stops once the two smallest keys add up to at least the best path through
+a node reached from both sides, usually long before all nodes are settled.
+
+Negative costs break that stopping rule, so such graphs are searched with a
+single FIFO Bellman-Ford from the source that is only stopped by convergence
+(or by a negative cycle). Either way only the path of the pair is returned.
+
+Distances inside the search may exceed INFINITY, unreachable pairs are reported
+with INFINITY like in the routing tables.
+
+*/
+
+#define PATH_UNREACHED (INT_MAX / 2)
+#define PATH_FORWARD 0
+#define PATH_BACKWARD 1
+
+/**
+ * @brief structure representing the answer to a query
+ *
+ * @param distance distance from the source to the destination, INFINITY if unreachable
+ * @param hops number of nodes on the path including both ends, 0 if unreachable
+ * @param path node IDs on the path, owned by the engine and valid until the next query
+ * @param settled number of nodes settled (or relaxed) by the search
+ * @param negative_cycle 1 if a negative cycle was found
+ */
+struct path_result {
+    int distance;
+    int hops;
+    int *path;
+    int settled;
+    int negative_cycle;
+};
+
+/**
+ * @brief structure representing the scratch data of the point-to-point search
+ *
+ * @param nodes number of nodes in the graph
+ * @param negative 1 if the graph has negative costs
+ * @param adjacency outgoing and incoming edges of every node
+ * @param heap heaps of both directions
+ * @param distance distances of both directions
+ * @param parent predecessor (forward) or successor (backward) of every node
+ * @param settled 1 for nodes settled by the direction
+ * @param touched nodes whose entries have to be reset after the query
+ * @param touched_count number of touched nodes
+ * @param mark 1 for touched nodes
+ * @param path path of the last query
+ * @param queue queue of the Bellman-Ford search (circular)
+ * @param updates number of times every node was queued by the Bellman-Ford search
+ */
+struct path_engine {
+    int nodes;
+    int negative;
+    struct adjacency *adjacency[2];
+    struct min_heap *heap[2];
+    int *distance[2];
+    int *parent[2];
+    char *settled[2];
+    int *touched;
+    int touched_count;
+    char *mark;
+    int *path;
+    int *queue;
+    int *updates;
+};
+
+/**
+ * @brief function initializing the point-to-point search for a graph
+ *
+ * @param G pointer to the graph
+ * @return struct path_engine* pointer to the engine
+ */
+struct path_engine *init_path_engine(struct graph *G)
+{
+    struct path_engine *P = (struct path_engine *)malloc(sizeof(struct path_engine));
+    int nodes = G->nodes;
+
+    P->nodes = nodes;
+    P->negative = 0;
+
+    for (int d = 0; d < 2; d++)
+    {
+        P->adjacency[d] = extract_adjacency(G, d);
+        P->heap[d] = init_heap(nodes);
+        P->distance[d] = (int *)malloc(sizeof(int) * nodes);
+        P->parent[d] = (int *)malloc(sizeof(int) * nodes);
+        P->settled[d] = (char *)calloc(nodes, 1);
+
+        for (int i = 0; i < nodes; i++)
+        {
+            P->distance[d][i] = PATH_UNREACHED;
+            P->parent[d][i] = NULL_PREDECESSOR;
+        }
+    }
+
+    for (int k = 0; k < P->adjacency[PATH_FORWARD]->edges; k++)
+    {
+        if (P->adjacency[PATH_FORWARD]->cost[k] < 0)
+            P->negative = 1;
+    }
+
+    P->touched = (int *)malloc(sizeof(int) * nodes);
+    P->touched_count = 0;
+    P->mark = (char *)calloc(nodes, 1);
+    P->path = (int *)malloc(sizeof(int) * (nodes + 1));
+    P->queue = (int *)malloc(sizeof(int) * (nodes + 1));
+    P->updates = (int *)calloc(nodes, sizeof(int));
+
+    return P;
+}
+
+/**
+ * @brief function freeing the point-to-point search
+ *
+ * @param P pointer to the engine
+ */
+void free_path_engine(struct path_engine *P)
+{
+    for (int d = 0; d < 2; d++)
+    {
+        free_adjacency(P->adjacency[d]);
+        free_heap(P->heap[d]);
+        free(P->distance[d]);
+        free(P->parent[d]);
+        free(P->settled[d]);
+    }
+
+    free(P->touched);
+    free(P->mark);
+    free(P->path);
+    free(P->queue);
+    free(P->updates);
+    free(P);
+}
+
+/**
+ * @brief function remembering a node to be reset after the query
+ *
+ * @param P pointer to the engine
+ * @param node node ID
+ */
+void path_touch(struct path_engine *P, int node)
+{
+    if (!P->mark[node])
+    {
+        P->mark[node] = 1;
+        P->touched[P->touched_count++] = node;
+    }
+}
+
+/**
+ * @brief function resetting the entries of all nodes touched by the last query
+ *
+ * @param P pointer to the engine
+ */
+void path_reset(struct path_engine *P)
+{
+    for (int t = 0; t < P->touched_count; t++)
+    {
+        int node = P->touched[t];
+
+        for (int d = 0; d < 2; d++)
+        {
+            P->distance[d][node] = PATH_UNREACHED;
+            P->parent[d][node] = NULL_PREDECESSOR;
+            P->settled[d][node] = 0;
+        }
+
+        P->updates[node] = 0;
+        P->mark[node] = 0;
+    }
+
+    P->touched_count = 0;
+    heap_clear(P->heap[PATH_FORWARD]);
+    heap_clear(P->heap[PATH_BACKWARD]);
+}
+
+/**
+ * @brief function answering a query with bidirectional Dijkstra
+ * @warning The graph must not have negative costs
+ *
+ * @param P pointer to the engine
+ * @param source source node ID
+ * @param destination destination node ID
+ * @param result pointer to the result to be filled
+ * @return int node where the searches met, NULL_PREDECESSOR if the destination is unreachable
+ */
+int path_bidirectional(struct path_engine *P, int source, int destination, struct path_result *result)
+{
+    int ends[2] = {source, destination};
+    int best = PATH_UNREACHED;
+    int meet = NULL_PREDECESSOR;
+
+    if (source == destination)
+    {
+        result->distance = 0;
+        return source;
+    }
+
+    for (int d = 0; d < 2; d++)
+    {
+        P->distance[d][ends[d]] = 0;
+        path_touch(P, ends[d]);
+        heap_push(P->heap[d], ends[d], 0);
+    }
+
+    while (P->heap[PATH_FORWARD]->size > 0 && P->heap[PATH_BACKWARD]->size > 0)
+    {
+        int top_forward = heap_top_key(P->heap[PATH_FORWARD]);
+        int top_backward = heap_top_key(P->heap[PATH_BACKWARD]);
+
+        if (top_forward + top_backward >= best)
+            break;
+
+        int d = top_forward <= top_backward ? PATH_FORWARD : PATH_BACKWARD;
+        int key;
+        int u = heap_pop(P->heap[d], &key);
+
+        P->settled[d][u] = 1;
+        result->settled++;
+
+        struct adjacency *A = P->adjacency[d];
+        for (int k = A->offset[u]; k < A->offset[u + 1]; k++)
+        {
+            int v = A->target[k];
+            int candidate = key + A->cost[k];
+
+            if (P->settled[d][v] || candidate >= P->distance[d][v])
+                continue;
+
+            P->distance[d][v] = candidate;
+            P->parent[d][v] = u;
+            path_touch(P, v);
+            heap_push(P->heap[d], v, candidate);
+
+            // Reached from both sides, a candidate for the shortest path
+            if (P->distance[1 - d][v] < PATH_UNREACHED && candidate + P->distance[1 - d][v] < best)
+            {
+                best = candidate + P->distance[1 - d][v];
+                meet = v;
+            }
+        }
+    }
+
+    result->distance = best;
+    return meet;
+}
+
+/**
+ * @brief function answering a query with Bellman-Ford from the source, for graphs with negative costs
+ *
+ * @param P pointer to the engine
+ * @param source source node ID
+ * @param destination destination node ID
+ * @param result pointer to the result to be filled
+ * @return int destination, NULL_PREDECESSOR if it is unreachable or on a negative cycle
+ */
+int path_bellman_ford(struct path_engine *P, int source, int destination, struct path_result *result)
+{
+    int *distance = P->distance[PATH_FORWARD];
+    int *parent = P->parent[PATH_FORWARD];
+    char *queued = P->settled[PATH_FORWARD];
+    struct adjacency *A = P->adjacency[PATH_FORWARD];
+    int head = 0;
+    int tail = 0;
+
+    distance[source] = 0;
+    path_touch(P, source);
+    P->queue[tail++] = source;
+    queued[source] = 1;
+
+    while (head != tail)
+    {
+        int u = P->queue[head];
+        head = (head + 1) % (P->nodes + 1);
+        queued[u] = 0;
+        result->settled++;
+
+        for (int k = A->offset[u]; k < A->offset[u + 1]; k++)
+        {
+            int v = A->target[k];
+            int candidate = distance[u] + A->cost[k];
+
+            if (candidate >= distance[v])
+                continue;
+
+            distance[v] = candidate;
+            parent[v] = u;
+            path_touch(P, v);
+
+            if (!queued[v])
+            {
+                // In FIFO order a node is queued at most once per pass
+                if (++P->updates[v] > P->nodes)
+                {
+                    result->negative_cycle = 1;
+                    result->distance = INFINITY;
+                    return NULL_PREDECESSOR;
+                }
+
+                queued[v] = 1;
+                P->queue[tail] = v;
+                tail = (tail + 1) % (P->nodes + 1);
+            }
+        }
+    }
+
+    result->distance = distance[destination];
+    return distance[destination] < PATH_UNREACHED ? destination : NULL_PREDECESSOR;
+}
+
+/**
+ * @brief function answering a point-to-point query
+ *
+ * @param P pointer to the engine
+ * @param source source node ID
+ * @param destination destination node ID
+ * @return struct path_result distance and path, the path is valid until the next query
+ */
+struct path_result query_path(struct path_engine *P, int source, int destination)
+{
+    struct path_result result;
+    result.distance = INFINITY;
+    result.hops = 0;
+    result.path = P->path;
+    result.settled = 0;
+    result.negative_cycle = 0;
+
+    int meet = P->negative ? path_bellman_ford(P, source, destination, &result)
+                           : path_bidirectional(P, source, destination, &result);
+
+    if (meet == NULL_PREDECESSOR)
+    {
+        result.distance = INFINITY;
+        path_reset(P);
+        return result;
+    }
+
+    // Source side of the path is collected backwards, then reversed
+    int hops = 0;
+    for (int node = meet; node != NULL_PREDECESSOR; node = P->parent[PATH_FORWARD][node])
+        P->path[hops++] = node;
+
+    for (int i = 0; i < hops / 2; i++)
+    {
+        int swap = P->path[i];
+        P->path[i] = P->path[hops - 1 - i];
+        P->path[hops - 1 - i] = swap;
+    }
+
+    if (!P->negative)
+    {
+        for (int node = P->parent[PATH_BACKWARD][meet]; node != NULL_PREDECESSOR; node = P->parent[PATH_BACKWARD][node])
+            P->path[hops++] = node;
+    }
+
+    result.hops = hops;
+    path_reset(P);
+
+    return result;
+}
+
+/**
+ * @brief function reading the queried pairs on node 0 and broadcasting them
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param filename name of the query file (only used on node 0)
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param count pointer to the number of queries
+ * @return int* pairs of node IDs [QUERY * 2 + 0/1]
+ */
+int *broadcast_queries(const char *filename, struct network *net, int rank, int *count)
+{
+    int *pairs = NULL;
+    *count = 0;
+
+    if (rank == 0)
+    {
+        FILE *fp = fopen(filename, "r");
+        if (fp == NULL)
+        {
+            printf("Cannot open query file %s\n", filename);
+            exit(EXIT_FAILURE);
+        }
+
+        int capacity = 64;
+        pairs = (int *)malloc(sizeof(int) * 2 * capacity);
+
+        char *line = NULL;
+        size_t len = 0;
+
+        while (getline(&line, &len, fp) != -1)
+        {
+            int from_as, to_as;
+
+            if (line[0] == '#' || sscanf(line, "%i %i", &from_as, &to_as) != 2)
+                continue;
+
+            int from = node_of_as(net->as_map, net->router_count, from_as);
+            int to = node_of_as(net->as_map, net->router_count, to_as);
+
+            if (net->as_map[from] != from_as || net->as_map[to] != to_as)
+            {
+                printf("Ignoring query of unknown AS %i - %i\n", from_as, to_as);
+                continue;
+            }
+
+            if (*count == capacity)
+            {
+                capacity *= 2;
+                pairs = (int *)realloc(pairs, sizeof(int) * 2 * capacity);
+            }
+
+            pairs[2 * *count] = from;
+            pairs[2 * *count + 1] = to;
+            (*count)++;
+        }
+
+        free(line);
+        fclose(fp);
+    }
+
+    MPI_Bcast(count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (rank != 0)
+        pairs = (int *)malloc(sizeof(int) * (2 * *count + 1));
+
+    MPI_Bcast(pairs, 2 * *count, MPI_INT, 0, MPI_COMM_WORLD);
+
+    return pairs;
+}
+
+/**
+ * @brief function comparing two latencies, for qsort
+ *
+ * @param a pointer to the first latency
+ * @param b pointer to the second latency
+ * @return int order of the latencies
+ */
+int compare_latency(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief function appending an answer to the packed answers of a process
+ *
+ * Answers are packed as: query, negative cycle, distance, settled, hops, path...
+ *
+ * @param answers pointer to the packed answers, grown when needed
+ * @param used pointer to the number of used entries
+ * @param capacity pointer to the number of allocated entries
+ * @param q index of the query
+ * @param res answer to the query
+ */
+void pack_path_answer(int **answers, int *used, int *capacity, int q, struct path_result res)
+{
+    if (*used + 5 + res.hops > *capacity)
+    {
+        *capacity = 2 * (*used + 5 + res.hops);
+        *answers = (int *)realloc(*answers, sizeof(int) * *capacity);
+    }
+
+    int *a = *answers + *used;
+    a[0] = q;
+    a[1] = res.negative_cycle;
+    a[2] = res.distance;
+    a[3] = res.settled;
+    a[4] = res.hops;
+    memcpy(a + 5, res.path, sizeof(int) * res.hops);
+    *used += 5 + res.hops;
+}
+
+/**
+ * @brief function gathering the packed answers on node 0, writing PATHS.txt and printing the latency
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param pairs pairs of node IDs [QUERY * 2 + 0/1]
+ * @param count number of queries
+ * @param answers packed answers of the calling process
+ * @param used number of entries of answers
+ * @param latency latencies of the queries answered by the calling process
+ * @param mine number of queries answered by the calling process
+ * @param method name of the search, for the report
+ * @param rank rank of the calling process
+ * @param size number of processes
+ */
+void write_path_answers(struct network *net, const int *pairs, int count, const int *answers, int used,
+                        const double *latency, int mine, const char *method, int rank, int size)
+{
+    int *sizes = NULL;
+    int *displs = NULL;
+    int *all = NULL;
+    double *all_latency = NULL;
+    int *latency_counts = NULL;
+    int *latency_displs = NULL;
+    int total = 0;
+
+    if (rank == 0)
+    {
+        sizes = (int *)malloc(sizeof(int) * size);
+        displs = (int *)malloc(sizeof(int) * size);
+        latency_counts = (int *)malloc(sizeof(int) * size);
+        latency_displs = (int *)malloc(sizeof(int) * size);
+        all_latency = (double *)malloc(sizeof(double) * (count + 1));
+    }
+
+    MPI_Gather(&used, 1, MPI_INT, sizes, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gather(&mine, 1, MPI_INT, latency_counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        int latency_total = 0;
+        for (int r = 0; r < size; r++)
+        {
+            displs[r] = total;
+            total += sizes[r];
+            latency_displs[r] = latency_total;
+            latency_total += latency_counts[r];
+        }
+        all = (int *)malloc(sizeof(int) * (total + 1));
+    }
+
+    MPI_Gatherv(answers, used, MPI_INT, all, sizes, displs, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(latency, mine, MPI_DOUBLE, all_latency, latency_counts, latency_displs, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        // Write the answers in the order of the query file
+        int *offset = (int *)malloc(sizeof(int) * (count + 1));
+        long settled = 0;
+
+        for (int at = 0; at < total; at += 5 + all[at + 4])
+        {
+            offset[all[at]] = at;
+            settled += all[at + 3];
+        }
+
+        FILE *fp = fopen("./PATHS.txt", "w");
+
+        for (int q = 0; q < count; q++)
+        {
+            int *a = all + offset[q];
+
+            fprintf(fp, "AS %i TO %i", net->as_map[pairs[2 * q]], net->as_map[pairs[2 * q + 1]]);
+
+            if (a[1])
+                fprintf(fp, " NEGATIVE CYCLE\n");
+            else if (a[4] == 0)
+                fprintf(fp, " UNREACHABLE\n");
+            else
+            {
+                fprintf(fp, " DIST %i PATH", a[2]);
+                for (int h = 0; h < a[4]; h++)
+                    fprintf(fp, " %i", net->as_map[a[5 + h]]);
+                fprintf(fp, "\n");
+            }
+        }
+
+        fclose(fp);
+
+        qsort(all_latency, count, sizeof(double), compare_latency);
+
+        if (count > 0)
+        {
+            printf("Path queries: %i answered by %s, %.1f nodes settled per query of %i\n",
+                   count, method, (double)settled / count, net->router_count);
+            printf("Path queries: latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                   1e6 * all_latency[count / 2], 1e6 * all_latency[(count * 99) / 100], 1e6 * all_latency[count - 1]);
+        }
+
+        free(offset);
+        free(sizes);
+        free(displs);
+        free(all);
+        free(all_latency);
+        free(latency_counts);
+        free(latency_displs);
+    }
+}
+
+/**
+ * @brief function answering a batch of queries, spread over the processes, and writing the paths on node 0
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param filename name of the query file (only used on node 0)
+ * @param rank rank of the calling process
+ * @param size number of processes
+ */
+void run_path_queries(struct network *net, const char *filename, int rank, int size)
+{
+    int count;
+    int *pairs = broadcast_queries(filename, net, rank, &count);
+    struct path_engine *P = init_path_engine(net->netgraph);
+
+    int capacity = 1024;
+    int used = 0;
+    int *answers = (int *)malloc(sizeof(int) * capacity);
+    int mine = 0;
+    double *latency = (double *)malloc(sizeof(double) * (count / size + 1));
+
+    for (int q = rank; q < count; q += size)
+    {
+        double start = MPI_Wtime();
+        struct path_result res = query_path(P, pairs[2 * q], pairs[2 * q + 1]);
+        latency[mine++] = MPI_Wtime() - start;
+
+        pack_path_answer(&answers, &used, &capacity, q, res);
+    }
+
+    int negative = P->negative;
+    free_path_engine(P);
+
+    write_path_answers(net, pairs, count, answers, used, latency, mine,
+                       negative ? "Bellman-Ford" : "bidirectional Dijkstra", rank, size);
+
+    free(answers);
+    free(latency);
+    free(pairs);
+}
+
+#endif
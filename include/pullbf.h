@@ -0,0 +1,565 @@
+/**
+ * @file pullbf.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief threaded pull (gather) Bellman-Ford over incoming edges, without atomics
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef PULLBF_H
+#define PULLBF_H
+
+#include "mpi.h"
+#include "pthread.h"
+#include "stdint.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "limits.h"
+
+#ifdef __AVX2__
+#include "immintrin.h"
+#endif
+
+#include "bellford.h"
+#include "graph.h"
+#include "network.h"
+#include "router.h"
+
+/*
+
+bellman_ford() pushes along every edge and writes distances[E[j].to], so two
+threads could write the same node. Here every node pulls: it takes the minimum
+over its incoming edges (CSC layout from extract_adjacency) and only its owner
+writes it. Threads own contiguous ranges of nodes aligned to 32, so they also
+own whole words of the frontier bitmaps and nothing is shared for writing.
+
+Distances and frontiers are double buffered by iteration parity:
+
+Jacobi              every node reads the previous iteration only
+chunked Gauss-Seidel a thread reads the nodes of its own range already updated
+                     in this iteration, other ranges from the previous one
+
+Only peers that changed in the previous iteration (or earlier in this one for
+Gauss-Seidel) are read, a node without such peers is skipped. With AVX2 the
+minimum is taken 8 edges at a time with masked gathers.
+
+*/
+
+#include "options.h"
+
+#define PULL_WORD 32
+#define PULL_UNREACHED (INT_MAX / 2)
+
+struct pull_engine;
+
+/**
+ * @brief structure representing the argument of a worker thread
+ *
+ * @param E pointer to the engine
+ * @param id index of the thread
+ */
+struct pull_worker {
+    struct pull_engine *E;
+    int id;
+};
+
+/**
+ * @brief structure representing the pull engine and its thread team
+ *
+ * @param nodes number of nodes in the graph
+ * @param words number of 32 bit words of a frontier bitmap
+ * @param threads number of threads including the calling one
+ * @param mode PULL_JACOBI or PULL_GAUSS_SEIDEL
+ * @param in incoming edges of every node
+ * @param bound thread T owns nodes bound[T] to bound[T + 1] - 1
+ * @param distance distances of both parities
+ * @param active frontier bitmaps of both parities
+ * @param predecessor predecessor of every node
+ * @param changed 1 for threads that changed a node, per parity [PARITY * threads + T]
+ * @param evaluated number of nodes with an active peer, per thread
+ * @param skipped number of nodes skipped by the frontier, per thread
+ * @param source source node of the current run
+ * @param iterations number of iterations of the last run
+ * @param negative_cycle 1 if the last run did not converge
+ * @param shutdown 1 when the workers have to exit
+ * @param workers worker threads
+ * @param args arguments of the worker threads
+ * @param barrier barrier of all threads
+ */
+struct pull_engine {
+    int nodes;
+    int words;
+    int threads;
+    int mode;
+    struct adjacency *in;
+    int *bound;
+    int *distance[2];
+    uint32_t *active[2];
+    int *predecessor;
+    int *changed;
+    long *evaluated;
+    long *skipped;
+    int source;
+    int iterations;
+    int negative_cycle;
+    int shutdown;
+    pthread_t *workers;
+    struct pull_worker *args;
+    pthread_barrier_t barrier;
+};
+
+
+/**
+ * @brief function computing the best incoming edge of a node
+ *
+ * @param E pointer to the engine
+ * @param v node ID
+ * @param cur distances of the previous iteration
+ * @param next distances of this iteration
+ * @param cur_active frontier of the previous iteration
+ * @param next_active frontier of this iteration
+ * @param lo first node of the calling thread
+ * @param hi last node of the calling thread + 1
+ * @param via pointer to the peer giving the best distance
+ * @param any pointer set to 1 if the node has an active peer
+ * @return int best distance through an active peer, PULL_UNREACHED if there is none
+ */
+static inline int pull_node(struct pull_engine *E, int v, const int *cur, const int *next,
+                            const uint32_t *cur_active, const uint32_t *next_active,
+                            int lo, int hi, int *via, int *any)
+{
+    const int *source = E->in->target;
+    const int *cost = E->in->cost;
+    int k = E->in->offset[v];
+    int end = E->in->offset[v + 1];
+    int own_range = E->mode == PULL_GAUSS_SEIDEL;
+    int best = PULL_UNREACHED;
+
+#ifdef __AVX2__
+    if (end - k >= 8)
+    {
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i low_bits = _mm256_set1_epi32(PULL_WORD - 1);
+        const __m256i below = _mm256_set1_epi32(own_range ? lo - 1 : INT_MAX);
+        const __m256i above = _mm256_set1_epi32(own_range ? hi : INT_MIN);
+        __m256i vbest = _mm256_set1_epi32(PULL_UNREACHED);
+        __m256i vvia = _mm256_set1_epi32(NULL_PREDECESSOR);
+        int lanes = 0;
+
+        for (; k + 8 <= end; k += 8)
+        {
+            __m256i u = _mm256_loadu_si256((const __m256i *)(source + k));
+            __m256i c = _mm256_loadu_si256((const __m256i *)(cost + k));
+            __m256i word_index = _mm256_srli_epi32(u, 5);
+            __m256i shift = _mm256_and_si256(u, low_bits);
+
+            __m256i word = _mm256_i32gather_epi32((const int *)cur_active, word_index, 4);
+            __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(word, shift), one);
+
+            // Peers in our own range may have changed earlier in this iteration
+            __m256i own = _mm256_and_si256(_mm256_cmpgt_epi32(u, below), _mm256_cmpgt_epi32(above, u));
+            if (!_mm256_testz_si256(own, own))
+            {
+                __m256i own_word = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)next_active, word_index, own, 4);
+                bit = _mm256_or_si256(bit, _mm256_and_si256(_mm256_srlv_epi32(own_word, shift), one));
+            }
+
+            __m256i mask = _mm256_cmpeq_epi32(bit, one);
+            if (_mm256_testz_si256(mask, mask))
+                continue;
+
+            lanes = 1;
+            __m256i d = _mm256_mask_i32gather_epi32(_mm256_set1_epi32(PULL_UNREACHED), cur, u, mask, 4);
+            __m256i own_mask = _mm256_and_si256(mask, own);
+            if (!_mm256_testz_si256(own_mask, own_mask))
+                d = _mm256_mask_i32gather_epi32(d, next, u, own_mask, 4);
+
+            __m256i candidate = _mm256_blendv_epi8(_mm256_set1_epi32(PULL_UNREACHED), _mm256_add_epi32(d, c), mask);
+            __m256i better = _mm256_cmpgt_epi32(vbest, candidate);
+            vbest = _mm256_blendv_epi8(vbest, candidate, better);
+            vvia = _mm256_blendv_epi8(vvia, u, better);
+        }
+
+        if (lanes)
+        {
+            int bests[8], vias[8];
+            _mm256_storeu_si256((__m256i *)bests, vbest);
+            _mm256_storeu_si256((__m256i *)vias, vvia);
+
+            for (int l = 0; l < 8; l++)
+            {
+                if (bests[l] < best)
+                {
+                    best = bests[l];
+                    *via = vias[l];
+                }
+            }
+
+            *any = 1;
+        }
+    }
+#endif
+
+    for (; k < end; k++)
+    {
+        int u = source[k];
+        int own = own_range && u >= lo && u < hi;
+        int active = (cur_active[u / PULL_WORD] >> (u % PULL_WORD)) & 1;
+
+        if (own)
+            active |= (next_active[u / PULL_WORD] >> (u % PULL_WORD)) & 1;
+
+        if (!active)
+            continue;
+
+        *any = 1;
+        int candidate = (own ? next[u] : cur[u]) + cost[k];
+
+        if (candidate < best)
+        {
+            best = candidate;
+            *via = u;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief function running the iterations of one source on the range of one thread
+ *
+ * @param E pointer to the engine
+ * @param id index of the thread
+ */
+void pull_iterate(struct pull_engine *E, int id)
+{
+    int lo = E->bound[id];
+    int hi = E->bound[id + 1];
+    int first_word = lo / PULL_WORD;
+    int last_word = (hi + PULL_WORD - 1) / PULL_WORD;
+    int it = 0;
+
+    while (1)
+    {
+        const int *cur = E->distance[it & 1];
+        int *next = E->distance[(it + 1) & 1];
+        const uint32_t *cur_active = E->active[it & 1];
+        uint32_t *next_active = E->active[(it + 1) & 1];
+        int changed = 0;
+
+        // A thread without nodes must not touch the words of its neighbours
+        if (lo < hi)
+        {
+            memcpy(next + lo, cur + lo, sizeof(int) * (hi - lo));
+            memset(next_active + first_word, 0, sizeof(uint32_t) * (last_word - first_word));
+        }
+
+        for (int v = lo; v < hi; v++)
+        {
+            int via = NULL_PREDECESSOR;
+            int any = 0;
+            int best = pull_node(E, v, cur, next, cur_active, next_active, lo, hi, &via, &any);
+
+            if (!any)
+            {
+                E->skipped[id]++;
+                continue;
+            }
+
+            E->evaluated[id]++;
+
+            if (best < next[v])
+            {
+                next[v] = best;
+                E->predecessor[v] = via;
+                next_active[v / PULL_WORD] |= 1u << (v % PULL_WORD);
+                changed = 1;
+            }
+        }
+
+        E->changed[(it & 1) * E->threads + id] = changed;
+        pthread_barrier_wait(&E->barrier);
+
+        int any_changed = 0;
+        for (int t = 0; t < E->threads; t++)
+            any_changed |= E->changed[(it & 1) * E->threads + t];
+
+        it++;
+
+        if (!any_changed)
+            break;
+
+        // Without negative cycles nothing changes after nodes - 1 iterations
+        if (it >= E->nodes)
+        {
+            if (id == 0)
+                E->negative_cycle = 1;
+            break;
+        }
+    }
+
+    if (id == 0)
+        E->iterations = it;
+}
+
+/**
+ * @brief function writing the range of a thread first, so its pages are placed on the node of the thread
+ * @warning Has to run before any other thread touches the shared arrays
+ *
+ * @param E pointer to the engine
+ * @param id index of the thread
+ */
+void pull_first_touch(struct pull_engine *E, int id)
+{
+    int lo = E->bound[id];
+    int hi = E->bound[id + 1];
+
+    if (lo >= hi)
+        return;
+
+    for (int p = 0; p < 2; p++)
+        memset(E->distance[p] + lo, 0, sizeof(int) * (hi - lo));
+    memset(E->predecessor + lo, 0, sizeof(int) * (hi - lo));
+}
+
+/**
+ * @brief function run by the worker threads, one source per round
+ *
+ * @param arg pointer to the struct pull_worker of the thread
+ * @return void* NULL
+ */
+void *pull_worker_main(void *arg)
+{
+    struct pull_worker *W = (struct pull_worker *)arg;
+    struct pull_engine *E = W->E;
+
+    pull_first_touch(E, W->id);
+    pthread_barrier_wait(&E->barrier);
+
+    while (1)
+    {
+        pthread_barrier_wait(&E->barrier);
+
+        if (E->shutdown)
+            break;
+
+        pull_iterate(E, W->id);
+        pthread_barrier_wait(&E->barrier);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief function initializing the pull engine and starting its threads
+ *
+ * @param G pointer to the graph
+ * @param threads number of threads including the calling one
+ * @param mode PULL_JACOBI or PULL_GAUSS_SEIDEL
+ * @return struct pull_engine* pointer to the engine
+ */
+struct pull_engine *init_pull_engine(struct graph *G, int threads, int mode)
+{
+    struct pull_engine *E = (struct pull_engine *)calloc(1, sizeof(struct pull_engine));
+    int nodes = G->nodes;
+
+    E->nodes = nodes;
+    E->words = (nodes + PULL_WORD - 1) / PULL_WORD;
+    E->threads = threads;
+    E->mode = mode;
+    E->in = extract_adjacency(G, 1);
+
+    // Ranges of about the same number of edges, cut at word boundaries
+    E->bound = (int *)malloc(sizeof(int) * (threads + 1));
+    long work = (long)E->in->edges + nodes;
+    int v = 0;
+
+    E->bound[0] = 0;
+    for (int t = 1; t < threads; t++)
+    {
+        long target = work * t / threads;
+        while (v < nodes && (long)E->in->offset[v] + v < target)
+            v++;
+
+        // Every inner bound is a whole word, only the last thread ends inside one
+        int aligned = (v + PULL_WORD / 2) / PULL_WORD * PULL_WORD;
+        if (aligned < E->bound[t - 1])
+            aligned = E->bound[t - 1];
+        if (aligned > nodes / PULL_WORD * PULL_WORD)
+            aligned = nodes / PULL_WORD * PULL_WORD;
+
+        E->bound[t] = aligned;
+    }
+    E->bound[threads] = nodes;
+
+    for (int p = 0; p < 2; p++)
+    {
+        E->distance[p] = (int *)malloc(sizeof(int) * (nodes + 1));
+        E->active[p] = (uint32_t *)calloc(E->words + 1, sizeof(uint32_t));
+        large_advise(E->distance[p], sizeof(int) * (nodes + 1));
+    }
+
+    E->predecessor = (int *)malloc(sizeof(int) * (nodes + 1));
+    large_advise(E->predecessor, sizeof(int) * (nodes + 1));
+    E->changed = (int *)calloc(2 * threads, sizeof(int));
+    E->evaluated = (long *)calloc(threads, sizeof(long));
+    E->skipped = (long *)calloc(threads, sizeof(long));
+
+    pthread_barrier_init(&E->barrier, NULL, threads);
+
+    E->workers = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    E->args = (struct pull_worker *)malloc(sizeof(struct pull_worker) * threads);
+
+    for (int t = 1; t < threads; t++)
+    {
+        E->args[t].E = E;
+        E->args[t].id = t;
+        pthread_create(&E->workers[t], NULL, pull_worker_main, &E->args[t]);
+    }
+
+    // Nobody initializes a source before every thread has placed its range
+    pull_first_touch(E, 0);
+    pthread_barrier_wait(&E->barrier);
+
+    return E;
+}
+
+/**
+ * @brief function stopping the threads and freeing the pull engine
+ *
+ * @param E pointer to the engine
+ */
+void free_pull_engine(struct pull_engine *E)
+{
+    E->shutdown = 1;
+    pthread_barrier_wait(&E->barrier);
+
+    for (int t = 1; t < E->threads; t++)
+        pthread_join(E->workers[t], NULL);
+
+    pthread_barrier_destroy(&E->barrier);
+
+    free_adjacency(E->in);
+    for (int p = 0; p < 2; p++)
+    {
+        free(E->distance[p]);
+        free(E->active[p]);
+    }
+
+    free(E->bound);
+    free(E->predecessor);
+    free(E->changed);
+    free(E->evaluated);
+    free(E->skipped);
+    free(E->workers);
+    free(E->args);
+    free(E);
+}
+
+/**
+ * @brief function computing the shortest paths from a source with the pull engine
+ *
+ * @param E pointer to the engine
+ * @param source_id ID of the source node
+ * @return struct bellman_results results in the format of bellman_ford, owned by the caller
+ */
+struct bellman_results pull_shortest_paths(struct pull_engine *E, int source_id)
+{
+    int nodes = E->nodes;
+
+    for (int i = 0; i < nodes; i++)
+    {
+        E->distance[0][i] = PULL_UNREACHED;
+        E->predecessor[i] = NULL_PREDECESSOR;
+    }
+
+    memset(E->active[0], 0, sizeof(uint32_t) * E->words);
+    E->distance[0][source_id] = 0;
+    E->active[0][source_id / PULL_WORD] |= 1u << (source_id % PULL_WORD);
+    E->source = source_id;
+    E->negative_cycle = 0;
+
+    // The calling thread works as thread 0
+    pthread_barrier_wait(&E->barrier);
+    pull_iterate(E, 0);
+    pthread_barrier_wait(&E->barrier);
+
+    if (E->negative_cycle)
+        printf("Graph contains a negative-weight cycle\n");
+
+    struct bellman_results res;
+    res.size = nodes;
+    res.distance = (int *)malloc(sizeof(int) * nodes);
+    res.predecessor = (int *)malloc(sizeof(int) * nodes);
+
+    const int *final = E->distance[E->iterations & 1];
+    for (int i = 0; i < nodes; i++)
+    {
+        res.distance[i] = final[i] >= PULL_UNREACHED ? INFINITY : final[i];
+    }
+    memcpy(res.predecessor, E->predecessor, sizeof(int) * nodes);
+
+    return res;
+}
+
+/**
+ * @brief function computing and describing the routers of a process with the pull engine
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @param threads number of threads per process
+ * @param mode PULL_JACOBI or PULL_GAUSS_SEIDEL
+ */
+void run_pull(struct network *net, int rank, int size, int threads, int mode)
+{
+    struct pull_engine *E = init_pull_engine(net->netgraph, threads, mode);
+    long local[3] = {0, 0, 0};
+    double compute = 0;
+
+    for (int i = rank; i < net->router_count; i += size)
+    {
+        double start = MPI_Wtime();
+        struct bellman_results res = pull_shortest_paths(E, i);
+        compute += MPI_Wtime() - start;
+        local[0] += E->iterations;
+
+        struct router *rtr = routing_info_from_results(net->as_map[i], net->netgraph, net->as_map, net->names[i], res);
+        describe_router(rtr);
+        free_router(rtr);
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        local[1] += E->evaluated[t];
+        local[2] += E->skipped[t];
+    }
+
+    free_pull_engine(E);
+
+    long total[3];
+    double slowest;
+    MPI_Reduce(local, total, 3, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&compute, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+#ifdef __AVX2__
+        const char *kernel = "AVX2 gathers";
+#else
+        const char *kernel = "scalar";
+#endif
+        printf("Pull engine: %s, %i threads per process, %s\n",
+               mode == PULL_JACOBI ? "Jacobi" : "chunked Gauss-Seidel", threads, kernel);
+        printf("Pull engine: %.1f iterations per router, %.1f%% of node updates skipped by the frontier, %.3f s on the slowest process\n",
+               (double)total[0] / net->router_count,
+               total[1] + total[2] > 0 ? 100.0 * total[2] / (total[1] + total[2]) : 0.0, slowest);
+    }
+}
+
+#endif
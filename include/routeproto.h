@@ -0,0 +1,121 @@
+/**
+ * @file routeproto.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief binary protocol of the route query server
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef ROUTEPROTO_H
+#define ROUTEPROTO_H
+
+#include "stdint.h"
+#include "unistd.h"
+#include "sys/socket.h"
+
+/*
+
+Every message starts with a route_header, all fields are in host byte order
+(the socket is local so there is no need to convert anything)
+
+ROUTE_OP_QUERY  request:  header + count * route_query
+                response: header + count * route_answer
+ROUTE_OP_INFO   request:  header (count = 0)
+                response: header + count * int32_t (AS numbers of all routers)
+
+*/
+
+#define ROUTE_MAGIC 0x52545131 // "RTQ1"
+#define ROUTE_MAX_BATCH 4096
+
+#define ROUTE_OP_QUERY 1
+#define ROUTE_OP_INFO 2
+
+/**
+ * @brief structure representing the header of every message
+ *
+ * @param magic protocol identifier, always ROUTE_MAGIC
+ * @param op requested operation
+ * @param count number of records following the header
+ */
+struct route_header {
+    uint32_t magic;
+    uint32_t op;
+    uint32_t count;
+};
+
+/**
+ * @brief structure representing a single route query
+ *
+ * @param from_as AS number of the source router
+ * @param to_as AS number of the destination router
+ */
+struct route_query {
+    int32_t from_as;
+    int32_t to_as;
+};
+
+/**
+ * @brief structure representing an answer to a single route query
+ *
+ * @param via_as AS number of the next hop, -1 if the route is unknown
+ * @param distance distance to the destination, -1 if the route is unknown
+ */
+struct route_answer {
+    int32_t via_as;
+    int32_t distance;
+};
+
+/**
+ * @brief function reading exactly len bytes from a descriptor
+ *
+ * @param fd descriptor to be read
+ * @param buf destination buffer
+ * @param len number of bytes to read
+ * @return int 0 on success, -1 on error or end of stream
+ */
+int route_read_full(int fd, void *buf, size_t len)
+{
+    char *ptr = (char *)buf;
+
+    while (len > 0)
+    {
+        ssize_t got = read(fd, ptr, len);
+        if (got <= 0)
+            return -1;
+        ptr += got;
+        len -= got;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief function writing exactly len bytes to a socket
+ *
+ * @param fd socket to be written
+ * @param buf source buffer
+ * @param len number of bytes to write
+ * @return int 0 on success, -1 on error (also when the peer has disconnected)
+ */
+int route_write_full(int fd, const void *buf, size_t len)
+{
+    const char *ptr = (const char *)buf;
+
+    while (len > 0)
+    {
+        // A closed peer gives EPIPE instead of SIGPIPE, which would kill the process
+        ssize_t put = send(fd, ptr, len, MSG_NOSIGNAL);
+        if (put <= 0)
+            return -1;
+        ptr += put;
+        len -= put;
+    }
+
+    return 0;
+}
+
+#endif
@@ -38,79 +38,122 @@ struct router
 };
 
 /**
- * @brief function generating routing information for a router using the Bellman-Ford algorithm
- * 
+ * @brief function finding the node ID of an AS number
+ *
+ * @param as_map array mapping node IDs to AS numbers
+ * @param nodes number of nodes in the network
+ * @param as_number AS number to be found
+ * @return int node ID, 0 if the AS is not in the network
+ */
+int node_of_as(const int *as_map, int nodes, int as_number)
+{
+    for (int i = 0; i < nodes; i++)
+    {
+        if (as_map[i] == as_number)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief function allocating a router without its routing tables
+ * @warning next_hop and distance are left NULL for the caller to fill
+ *
  * @param as_number AS number of the router
- * @param src_net pointer to the source network graph
+ * @param nodes number of nodes in the network
  * @param as_map array mapping node IDs to AS numbers
  * @param name name of the router
- * @return struct router* pointer to the generated router structure
+ * @return struct router* pointer to the allocated router structure
  */
-struct router *generate_routing_info(int as_number, struct graph *src_net, int *as_map, const char *name)
+struct router *init_router(int as_number, int nodes, const int *as_map, const char *name)
 {
     struct router *rtr = (struct router *)malloc(sizeof(struct router));
 
     rtr->as_number = as_number;
-    rtr->tracked_nodes = src_net->nodes;
+    rtr->tracked_nodes = nodes;
 
     rtr->name = (char *)malloc(strlen(name) + 1);
     strcpy(rtr->name, name);
 
-    rtr->as_map = (int *)malloc(sizeof(int) * src_net->nodes);
-    memcpy(rtr->as_map, as_map, sizeof(int) * src_net->nodes);
-
-    rtr->next_hop = (int *)malloc(sizeof(int) * src_net->nodes);
-
-    int my_node_id = 0;
-    for (int i = 0; i < rtr->tracked_nodes; i++)
-    {
-        rtr->next_hop[i] = NO_CONNECTION;
+    rtr->as_map = (int *)malloc(sizeof(int) * nodes);
+    memcpy(rtr->as_map, as_map, sizeof(int) * nodes);
 
-        if (as_map[i] == as_number)
-        {
-            my_node_id = i;
-            break;
-        }
-    }
+    rtr->next_hop = NULL;
+    rtr->distance = NULL;
 
-    rtr->next_hop[my_node_id] = my_node_id;
+    return rtr;
+}
 
-    struct bellman_results res = bellman_ford(src_net, my_node_id);
+/**
+ * @brief function computing the next hop to every node from the shortest path predecessors
+ *
+ * @param next_hop array to be filled with the next hop node IDs
+ * @param nodes number of nodes in the network
+ * @param my_node_id node ID of the router
+ * @param predecessor predecessors on the shortest paths from the router
+ */
+void compute_next_hops(int *next_hop, int nodes, int my_node_id, const int *predecessor)
+{
     int had_to_fix = 0;
 
     printf("My ID %i\n", my_node_id);
 
 
-    for (int i = 0; i < rtr->tracked_nodes; i++)
+    for (int i = 0; i < nodes; i++)
     {
         printf("Initialized hop %i with %i\n", i, i);
-        rtr->next_hop[i] = i;
+        next_hop[i] = i;
     }
 
     do
     {
         had_to_fix = 0;
         // Loop over all nodes
-        for (int i = 0; i < rtr->tracked_nodes; i++)
+        for (int i = 0; i < nodes; i++)
         {
             // Don't touch source node
             if (i == my_node_id)
                 continue;
 
             // If next hop is linked directly, ignore
-            if (res.predecessor[rtr->next_hop[i]] == my_node_id)
+            if (predecessor[next_hop[i]] == my_node_id)
                 continue;
             else
             {
                 // Else alter next hop to that of its predecessor
-                rtr->next_hop[i] = res.predecessor[rtr->next_hop[i]];
+                next_hop[i] = predecessor[next_hop[i]];
                 had_to_fix = 1;
 
-                printf("Swapped node %i with %i\n", i, rtr->next_hop[i]);
+                printf("Swapped node %i with %i\n", i, next_hop[i]);
             }
         }
 
     } while (had_to_fix);
+}
+
+/**
+ * @brief function generating routing information for a router from its shortest path results
+ * @warning Takes ownership of both arrays of res
+ *
+ * @param as_number AS number of the router
+ * @param src_net pointer to the source network graph
+ * @param as_map array mapping node IDs to AS numbers
+ * @param name name of the router
+ * @param res shortest paths computed from the router's node
+ * @return struct router* pointer to the generated router structure
+ */
+struct router *routing_info_from_results(int as_number, struct graph *src_net, int *as_map, const char *name, struct bellman_results res)
+{
+    struct router *rtr = init_router(as_number, src_net->nodes, as_map, name);
+
+    rtr->next_hop = (int *)malloc(sizeof(int) * src_net->nodes);
+
+    int my_node_id = node_of_as(as_map, src_net->nodes, as_number);
+
+    compute_next_hops(rtr->next_hop, rtr->tracked_nodes, my_node_id, res.predecessor);
 
     rtr->distance = res.distance;
     // free(res.distance); // Do not free, it's reusable
@@ -119,6 +162,57 @@ struct router *generate_routing_info(int as_number, struct graph *src_net, int *
     return rtr;
 }
 
+/**
+ * @brief function generating routing information for a router using the Bellman-Ford algorithm
+ * 
+ * @param as_number AS number of the router
+ * @param src_net pointer to the source network graph
+ * @param as_map array mapping node IDs to AS numbers
+ * @param name name of the router
+ * @return struct router* pointer to the generated router structure
+ */
+struct router *generate_routing_info(int as_number, struct graph *src_net, int *as_map, const char *name)
+{
+    int my_node_id = node_of_as(as_map, src_net->nodes, as_number);
+
+    struct bellman_results res = bellman_ford(src_net, my_node_id);
+
+    return routing_info_from_results(as_number, src_net, as_map, name, res);
+}
+
+/**
+ * @brief function generating routing information for a router with all memory taken from an arena
+ * @warning The router shares as_map and name with the caller and must not be passed to free_router,
+ * it lives until the arena is reset
+ *
+ * @param A pointer to the arena
+ * @param ws pointer to the Bellman-Ford workspace of src_net
+ * @param as_number AS number of the router
+ * @param src_net pointer to the source network graph
+ * @param as_map array mapping node IDs to AS numbers
+ * @param name name of the router
+ * @return struct router* pointer to the generated router structure
+ */
+struct router *generate_routing_info_arena(struct arena *A, struct sssp_workspace *ws, int as_number, struct graph *src_net, int *as_map, char *name)
+{
+    int my_node_id = node_of_as(as_map, src_net->nodes, as_number);
+
+    struct bellman_results res = bellman_ford_scratch(ws, A, my_node_id);
+
+    struct router *rtr = (struct router *)arena_alloc(A, sizeof(struct router));
+
+    rtr->as_number = as_number;
+    rtr->tracked_nodes = src_net->nodes;
+    rtr->name = name;
+    rtr->as_map = as_map;
+    rtr->next_hop = (int *)arena_alloc(A, sizeof(int) * src_net->nodes);
+    rtr->distance = res.distance;
+
+    compute_next_hops(rtr->next_hop, rtr->tracked_nodes, my_node_id, res.predecessor);
+
+    return rtr;
+}
+
 /**
  * @brief function to describe/pretty print the routing information of a router
  * @warning This function creates a file with the routing information as well
@@ -0,0 +1,697 @@
+/**
+ * @file routeserver.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief route query server keeping all routing tables resident
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef ROUTESERVER_H
+#define ROUTESERVER_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "poll.h"
+#include "pthread.h"
+#include "signal.h"
+#include "stdatomic.h"
+#include "unistd.h"
+#include "sys/socket.h"
+#include "sys/un.h"
+
+#include "network.h"
+#include "options.h"
+#include "router.h"
+#include "routeproto.h"
+#include "routetable.h"
+
+#define ROUTE_SERVER_MAX_THREADS 64
+#define ROUTE_SERVER_POLL_MS 200
+
+#define SERVER_CMD_WAIT 0
+#define SERVER_CMD_RELOAD 1
+#define SERVER_CMD_STOP 2
+
+/**
+ * @brief structure representing an immutable snapshot of all routing tables
+ *
+ * @param nodes number of nodes in the network
+ * @param generation number of the snapshot, incremented on every reload
+ * @param table compact routing tables of all routers
+ * @param index_size size of the AS number lookup table (power of two)
+ * @param index_keys AS numbers stored in the lookup table
+ * @param index_values node IDs stored in the lookup table, -1 for empty slots
+ */
+struct route_snapshot {
+    int nodes;
+    unsigned long generation;
+    struct route_table *table;
+    int index_size;
+    int *index_keys;
+    int *index_values;
+};
+
+/**
+ * @brief function hashing an AS number into the lookup table
+ *
+ * @param as_number AS number to be hashed
+ * @param index_size size of the lookup table (power of two)
+ * @return int slot of the AS number
+ */
+int snapshot_hash(int as_number, int index_size)
+{
+    unsigned int h = (unsigned int)as_number * 2654435761u;
+    return (int)(h & (unsigned int)(index_size - 1));
+}
+
+/**
+ * @brief function building the AS number lookup table of a snapshot
+ *
+ * @param snap pointer to the snapshot
+ */
+void snapshot_build_index(struct route_snapshot *snap)
+{
+    snap->index_size = 1;
+    while (snap->index_size < 2 * snap->nodes)
+    {
+        snap->index_size <<= 1;
+    }
+
+    snap->index_keys = (int *)malloc(sizeof(int) * snap->index_size);
+    snap->index_values = (int *)malloc(sizeof(int) * snap->index_size);
+
+    for (int i = 0; i < snap->index_size; i++)
+    {
+        snap->index_values[i] = -1;
+    }
+
+    for (int i = 0; i < snap->nodes; i++)
+    {
+        int slot = snapshot_hash(snap->table->as_map[i], snap->index_size);
+        while (snap->index_values[slot] != -1)
+        {
+            slot = (slot + 1) & (snap->index_size - 1);
+        }
+        snap->index_keys[slot] = snap->table->as_map[i];
+        snap->index_values[slot] = i;
+    }
+}
+
+/**
+ * @brief function finding the node ID of an AS number
+ *
+ * @param snap pointer to the snapshot
+ * @param as_number AS number to be found
+ * @return int node ID, -1 if the AS is not in the network
+ */
+int snapshot_node_of(const struct route_snapshot *snap, int as_number)
+{
+    int slot = snapshot_hash(as_number, snap->index_size);
+
+    while (snap->index_values[slot] != -1)
+    {
+        if (snap->index_keys[slot] == as_number)
+            return snap->index_values[slot];
+        slot = (slot + 1) & (snap->index_size - 1);
+    }
+
+    return -1;
+}
+
+/**
+ * @brief function answering a single query from a snapshot
+ *
+ * @param snap pointer to the snapshot
+ * @param query pointer to the query
+ * @return struct route_answer answer, -1 in both fields if the route is unknown
+ */
+struct route_answer snapshot_lookup(const struct route_snapshot *snap, const struct route_query *query)
+{
+    struct route_answer answer;
+    answer.via_as = -1;
+    answer.distance = -1;
+
+    int from = snapshot_node_of(snap, query->from_as);
+    int to = snapshot_node_of(snap, query->to_as);
+
+    if (from < 0 || to < 0)
+        return answer;
+
+    int distance = route_table_distance(snap->table, from, to);
+    int via = route_table_next_hop(snap->table, from, to);
+
+    if (distance >= INFINITY || via == ROUTE_TABLE_NO_HOP)
+        return answer;
+
+    answer.via_as = snap->table->as_map[via];
+    answer.distance = distance;
+
+    return answer;
+}
+
+/**
+ * @brief function freeing a snapshot
+ *
+ * @param snap pointer to the snapshot
+ */
+void free_snapshot(struct route_snapshot *snap)
+{
+    if (snap == NULL)
+        return;
+
+    free_route_table(snap->table);
+    free(snap->index_keys);
+    free(snap->index_values);
+    free(snap);
+}
+
+/**
+ * @brief function computing the routing tables of all routers and gathering them on node 0
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @return struct route_snapshot* complete snapshot on node 0, NULL on other nodes
+ */
+struct route_snapshot *gather_snapshot(struct network *net, int rank, int size)
+{
+    int nodes = net->router_count;
+    int rounds = (nodes + size - 1) / size;
+
+    // Every process owns routers rank, rank + size, rank + 2 * size...
+    // In round k every process sends its k-th row, node 0 compresses the rows
+    // right away so only one row per process is ever held uncompressed
+    int *row = (int *)malloc(sizeof(int) * 2 * nodes);
+    int *all_rows = NULL;
+    struct route_table *table = NULL;
+
+    if (rank == 0)
+    {
+        all_rows = (int *)malloc(sizeof(int) * 2 * nodes * size);
+        table = init_route_table(net->netgraph, net->as_map);
+    }
+
+    for (int k = 0; k < rounds; k++)
+    {
+        int i = rank + k * size;
+
+        if (i < nodes)
+        {
+            struct router *rtr = generate_routing_info(net->as_map[i], net->netgraph, net->as_map, net->names[i]);
+            memcpy(row, rtr->next_hop, sizeof(int) * nodes);
+            memcpy(row + nodes, rtr->distance, sizeof(int) * nodes);
+            free_router(rtr);
+        }
+
+        MPI_Gather(row, 2 * nodes, MPI_INT, all_rows, 2 * nodes, MPI_INT, 0, MPI_COMM_WORLD);
+
+        if (rank == 0)
+        {
+            for (int r = 0; r < size && r + k * size < nodes; r++)
+            {
+                int *hops = all_rows + (long)r * 2 * nodes;
+                route_table_set_row(table, r + k * size, hops, hops + nodes);
+            }
+        }
+    }
+
+    free(row);
+
+    if (rank != 0)
+        return NULL;
+
+    free(all_rows);
+    route_table_seal(table);
+
+    struct route_snapshot *snap = (struct route_snapshot *)malloc(sizeof(struct route_snapshot));
+    snap->nodes = nodes;
+    snap->generation = 0;
+    snap->table = table;
+
+    snapshot_build_index(snap);
+
+    // Separate struct router tables would hold as_map, next_hop and distance per router
+    size_t flat_bytes = (size_t)nodes * nodes * 3 * sizeof(int);
+    printf("Routing tables use %zu bytes (%zu as separate router tables)\n", route_table_bytes(table), flat_bytes);
+
+    return snap;
+}
+
+/*
+
+Snapshots are published RCU style: readers never take a lock, they announce
+the epoch they started in, load the current pointer and clear the announcement
+when done. The writer swaps the pointer, advances the epoch and frees the old
+snapshot only after every reader is either idle or started in the new epoch.
+
+*/
+
+/**
+ * @brief structure representing the read side state of one query thread
+ *
+ * @param epoch epoch in which the current read started, 0 when idle
+ * @param pad padding keeping readers on separate cache lines
+ */
+struct rcu_reader {
+    atomic_ulong epoch;
+    char pad[64 - sizeof(atomic_ulong)];
+};
+
+/**
+ * @brief structure representing the snapshot publication domain
+ *
+ * @param current currently published snapshot
+ * @param epoch global epoch, starts at 1
+ * @param readers read side state of all query threads
+ */
+struct rcu_domain {
+    _Atomic(struct route_snapshot *) current;
+    atomic_ulong epoch;
+    struct rcu_reader readers[ROUTE_SERVER_MAX_THREADS];
+};
+
+/**
+ * @brief function initializing the publication domain
+ *
+ * @param domain pointer to the domain
+ * @param first first snapshot to be published
+ */
+void rcu_init(struct rcu_domain *domain, struct route_snapshot *first)
+{
+    atomic_store(&domain->current, first);
+    atomic_store(&domain->epoch, 1);
+
+    for (int i = 0; i < ROUTE_SERVER_MAX_THREADS; i++)
+    {
+        atomic_store(&domain->readers[i].epoch, 0);
+    }
+}
+
+/**
+ * @brief function entering the read side critical section
+ *
+ * @param domain pointer to the domain
+ * @param reader ID of the reading thread
+ * @return struct route_snapshot* snapshot valid until rcu_read_unlock
+ */
+struct route_snapshot *rcu_read_lock(struct rcu_domain *domain, int reader)
+{
+    atomic_store(&domain->readers[reader].epoch, atomic_load(&domain->epoch));
+    return atomic_load(&domain->current);
+}
+
+/**
+ * @brief function leaving the read side critical section
+ *
+ * @param domain pointer to the domain
+ * @param reader ID of the reading thread
+ */
+void rcu_read_unlock(struct rcu_domain *domain, int reader)
+{
+    atomic_store(&domain->readers[reader].epoch, 0);
+}
+
+/**
+ * @brief function publishing a new snapshot and freeing the old one once no reader uses it
+ *
+ * @param domain pointer to the domain
+ * @param next snapshot to be published
+ */
+void rcu_publish(struct rcu_domain *domain, struct route_snapshot *next)
+{
+    struct route_snapshot *old = atomic_exchange(&domain->current, next);
+    unsigned long new_epoch = atomic_fetch_add(&domain->epoch, 1) + 1;
+
+    // Wait for the grace period, only readers which started before the swap matter
+    for (int i = 0; i < ROUTE_SERVER_MAX_THREADS; i++)
+    {
+        unsigned long seen = atomic_load(&domain->readers[i].epoch);
+        while (seen != 0 && seen < new_epoch)
+        {
+            usleep(100);
+            seen = atomic_load(&domain->readers[i].epoch);
+        }
+    }
+
+    free_snapshot(old);
+}
+
+/**
+ * @brief structure representing the shared state of the route server
+ *
+ * @param domain snapshot publication domain
+ * @param listen_fd listening socket
+ * @param running 1 while the server accepts queries
+ * @param queries number of answered queries
+ * @param batches number of answered batches
+ */
+struct route_server {
+    struct rcu_domain domain;
+    int listen_fd;
+    atomic_int running;
+    atomic_ulong queries;
+    atomic_ulong batches;
+};
+
+/**
+ * @brief structure representing the argument of a query thread
+ *
+ * @param server pointer to the server
+ * @param reader ID of the thread in the publication domain
+ * @param as_map copy of the AS numbers of the current snapshot, sent outside the read section
+ * @param as_capacity number of entries as_map can hold
+ */
+struct route_worker {
+    struct route_server *server;
+    int reader;
+    int32_t *as_map;
+    uint32_t as_capacity;
+};
+
+static volatile sig_atomic_t route_server_reload = 0;
+static volatile sig_atomic_t route_server_stop = 0;
+
+/**
+ * @brief signal handler requesting a reload (SIGHUP, SIGUSR1) or shutdown (SIGINT, SIGTERM)
+ *
+ * @param signo received signal
+ */
+void route_server_signal(int signo)
+{
+    if (signo == SIGHUP || signo == SIGUSR1)
+        route_server_reload = 1;
+    else
+        route_server_stop = 1;
+}
+
+/**
+ * @brief function waiting until a descriptor is readable or the server stops
+ *
+ * @param server pointer to the server
+ * @param fd descriptor to wait on
+ * @return int 1 if readable, 0 if the server stopped
+ */
+int route_server_wait(struct route_server *server, int fd)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    while (atomic_load(&server->running))
+    {
+        pfd.revents = 0;
+        if (poll(&pfd, 1, ROUTE_SERVER_POLL_MS) > 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief function serving a single client connection until it disconnects
+ *
+ * @param worker pointer to the query thread
+ * @param fd connected client socket
+ * @param queries buffer for ROUTE_MAX_BATCH queries
+ * @param answers buffer for ROUTE_MAX_BATCH answers
+ */
+void route_server_client(struct route_worker *worker, int fd, struct route_query *queries, struct route_answer *answers)
+{
+    struct route_server *server = worker->server;
+    struct route_header header;
+
+    while (route_server_wait(server, fd))
+    {
+        if (route_read_full(fd, &header, sizeof(header)) != 0)
+            return;
+
+        if (header.magic != ROUTE_MAGIC)
+            return;
+
+        if (header.op == ROUTE_OP_INFO)
+        {
+            // A slow client must not hold back the reclamation of old snapshots
+            struct route_snapshot *snap = rcu_read_lock(&server->domain, worker->reader);
+            header.count = snap->nodes;
+            if (header.count > worker->as_capacity)
+            {
+                free(worker->as_map);
+                worker->as_map = (int32_t *)malloc(sizeof(int32_t) * header.count);
+                worker->as_capacity = header.count;
+            }
+            memcpy(worker->as_map, snap->table->as_map, sizeof(int32_t) * header.count);
+            rcu_read_unlock(&server->domain, worker->reader);
+
+            if (route_write_full(fd, &header, sizeof(header)) != 0 ||
+                route_write_full(fd, worker->as_map, sizeof(int32_t) * header.count) != 0)
+                return;
+        }
+        else if (header.op == ROUTE_OP_QUERY && header.count <= ROUTE_MAX_BATCH)
+        {
+            if (route_read_full(fd, queries, sizeof(struct route_query) * header.count) != 0)
+                return;
+
+            struct route_snapshot *snap = rcu_read_lock(&server->domain, worker->reader);
+            for (uint32_t i = 0; i < header.count; i++)
+            {
+                answers[i] = snapshot_lookup(snap, &queries[i]);
+            }
+            rcu_read_unlock(&server->domain, worker->reader);
+
+            if (route_write_full(fd, &header, sizeof(header)) != 0 ||
+                route_write_full(fd, answers, sizeof(struct route_answer) * header.count) != 0)
+                return;
+
+            atomic_fetch_add(&server->queries, header.count);
+            atomic_fetch_add(&server->batches, 1);
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief function of a query thread, accepts clients and answers their queries
+ *
+ * @param arg pointer to the struct route_worker
+ * @return void* always NULL
+ */
+void *route_server_worker(void *arg)
+{
+    struct route_worker *worker = (struct route_worker *)arg;
+    struct route_server *server = worker->server;
+
+    struct route_query *queries = (struct route_query *)malloc(sizeof(struct route_query) * ROUTE_MAX_BATCH);
+    struct route_answer *answers = (struct route_answer *)malloc(sizeof(struct route_answer) * ROUTE_MAX_BATCH);
+    worker->as_map = NULL;
+    worker->as_capacity = 0;
+
+    while (route_server_wait(server, server->listen_fd))
+    {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue; // Another thread took the client
+
+        route_server_client(worker, fd, queries, answers);
+        close(fd);
+    }
+
+    free(queries);
+    free(answers);
+    free(worker->as_map);
+    return NULL;
+}
+
+/**
+ * @brief function opening the listening Unix socket
+ *
+ * @param path path of the socket
+ * @return int listening descriptor, -1 on error
+ */
+int route_server_listen(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/**
+ * @brief function running the route server until SIGINT or SIGTERM
+ * @warning This function is collective, node 0 serves queries while the others
+ * wait for reload requests (SIGHUP or SIGUSR1 on node 0) and recompute their share of the tables
+ *
+ * @param opts pointer to the command line options
+ * @param net pointer to the network pointer, replaced on every reload
+ * @param rank rank of the calling process
+ * @param size number of processes
+ */
+void run_route_server(struct run_options *opts, struct network **net, int rank, int size)
+{
+    struct route_snapshot *snap = gather_snapshot(*net, rank, size);
+
+    struct route_server *server = NULL;
+    pthread_t threads[ROUTE_SERVER_MAX_THREADS];
+    struct route_worker workers[ROUTE_SERVER_MAX_THREADS];
+    int thread_count = opts->serve_threads;
+
+    if (thread_count > ROUTE_SERVER_MAX_THREADS)
+        thread_count = ROUTE_SERVER_MAX_THREADS;
+
+    int failed = 0;
+
+    if (rank == 0)
+    {
+        server = (struct route_server *)malloc(sizeof(struct route_server));
+        rcu_init(&server->domain, snap);
+        atomic_store(&server->running, 1);
+        atomic_store(&server->queries, 0);
+        atomic_store(&server->batches, 0);
+
+        server->listen_fd = route_server_listen(opts->serve_socket);
+        if (server->listen_fd < 0)
+        {
+            fprintf(stderr, "Cannot listen on %s: %s\n", opts->serve_socket, strerror(errno));
+            failed = 1;
+        }
+    }
+
+    MPI_Bcast(&failed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (failed)
+    {
+        if (rank == 0)
+        {
+            free_snapshot(snap);
+            free(server);
+        }
+        return;
+    }
+
+    // mpirun forwards signals to every process, only node 0 acts on them
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = route_server_signal;
+    sigaction(SIGHUP, &action, NULL);
+    sigaction(SIGUSR1, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (rank == 0)
+    {
+        // Signals are handled by the main thread only
+        sigset_t blocked, previous;
+        sigemptyset(&blocked);
+        sigaddset(&blocked, SIGHUP);
+        sigaddset(&blocked, SIGUSR1);
+        sigaddset(&blocked, SIGINT);
+        sigaddset(&blocked, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+
+        for (int i = 0; i < thread_count; i++)
+        {
+            workers[i].server = server;
+            workers[i].reader = i;
+            int error = pthread_create(&threads[i], NULL, route_server_worker, &workers[i]);
+
+            if (error != 0)
+            {
+                // Serve with the threads already running, only joined threads are counted
+                fprintf(stderr, "Cannot start query thread %i: %s\n", i, strerror(error));
+                thread_count = i;
+            }
+        }
+
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+        if (thread_count == 0)
+            route_server_stop = 1; // Nobody would answer, all processes stop at the first command
+        else
+            printf("Serving %i routers on %s with %i threads\n", (*net)->router_count, opts->serve_socket, thread_count);
+        fflush(stdout);
+    }
+
+    unsigned long generation = 0;
+
+    while (1)
+    {
+        int cmd = SERVER_CMD_WAIT;
+
+        if (rank == 0)
+        {
+            while (!route_server_stop && !route_server_reload)
+            {
+                usleep(ROUTE_SERVER_POLL_MS * 1000);
+            }
+
+            cmd = route_server_stop ? SERVER_CMD_STOP : SERVER_CMD_RELOAD;
+            route_server_reload = 0;
+        }
+
+        MPI_Bcast(&cmd, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+        if (cmd == SERVER_CMD_STOP)
+            break;
+
+        // Reload the configuration, queries keep using the old snapshot meanwhile
+        free_network(*net);
+        *net = broadcast_network(opts->config_file, rank);
+        snap = gather_snapshot(*net, rank, size);
+
+        if (rank == 0)
+        {
+            snap->generation = ++generation;
+            rcu_publish(&server->domain, snap);
+            printf("Published snapshot %lu with %i routers\n", generation, snap->nodes);
+            fflush(stdout);
+        }
+    }
+
+    if (rank == 0)
+    {
+        atomic_store(&server->running, 0);
+
+        for (int i = 0; i < thread_count; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+
+        close(server->listen_fd);
+        unlink(opts->serve_socket);
+
+        printf("Answered %lu queries in %lu batches\n", atomic_load(&server->queries), atomic_load(&server->batches));
+
+        free_snapshot(atomic_load(&server->domain.current));
+        free(server);
+    }
+}
+
+#endif
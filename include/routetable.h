@@ -0,0 +1,370 @@
+/**
+ * @file routetable.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief compact storage of the routing tables of all routers
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef ROUTETABLE_H
+#define ROUTETABLE_H
+
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "graph.h"
+
+/*
+
+Next hops are stored as indices into the list of peers of the source router
+(code 0 is the router itself, code k is its (k - 1)-th peer), so a router
+with less than 254 peers needs a single byte per destination.
+
+Distances are stored as codes into a dictionary of distinct distances shared
+by the whole table. A network with at most 256 distinct distances needs a
+single byte per destination, larger ones are widened to 2 bytes and finally
+to raw 4 byte values. Both lookups stay O(1).
+
+*/
+
+#define ROUTE_TABLE_NO_HOP -1
+#define ROUTE_TABLE_DICT_MAX 65536
+
+/**
+ * @brief structure representing the routing tables of all routers
+ *
+ * @param nodes number of nodes in the network
+ * @param as_map array mapping node IDs to AS numbers, shared by all routers
+ * @param peer_offset start of the peers of every node in peer_node [nodes + 1]
+ * @param peer_node peers of all nodes, sorted by node ID within every node
+ * @param hop_width bytes per next hop code (1 or 2)
+ * @param hops next hop codes [SOURCE ID * nodes + NODE ID]
+ * @param dist_width bytes per distance code (1, 2 or 4 for raw values)
+ * @param dists distance codes [SOURCE ID * nodes + NODE ID]
+ * @param dict_size number of distinct distances in the dictionary
+ * @param dict distinct distances [CODE -> DISTANCE]
+ * @param dict_slots hash table of the dictionary [DISTANCE -> CODE + 1], 0 for empty slots
+ * @param dict_keys distances stored in the hash table
+ */
+struct route_table {
+    int nodes;
+    int *as_map;
+    int *peer_offset;
+    int *peer_node;
+    int hop_width;
+    uint8_t *hops;
+    int dist_width;
+    uint8_t *dists;
+    int dict_size;
+    int *dict;
+    int *dict_slots;
+    int *dict_keys;
+};
+
+/**
+ * @brief function initializing an empty routing table store for a network
+ *
+ * @param G pointer to the network graph
+ * @param as_map array mapping node IDs to AS numbers
+ * @return struct route_table* pointer to the initialized store
+ */
+struct route_table *init_route_table(struct graph *G, const int *as_map)
+{
+    struct route_table *T = (struct route_table *)malloc(sizeof(struct route_table));
+    int nodes = G->nodes;
+
+    T->nodes = nodes;
+    T->as_map = (int *)malloc(sizeof(int) * nodes);
+    memcpy(T->as_map, as_map, sizeof(int) * nodes);
+
+    // Peers of every node, the only possible next hops
+    T->peer_offset = (int *)malloc(sizeof(int) * (nodes + 1));
+    T->peer_offset[0] = 0;
+
+    int max_degree = 0;
+    for (int i = 0; i < nodes; i++)
+    {
+        int degree = 0;
+        for (int j = 0; j < nodes; j++)
+        {
+            if (i != j && get_edge(G, i, j) != NO_CONNECTION)
+                degree++;
+        }
+        T->peer_offset[i + 1] = T->peer_offset[i] + degree;
+        if (degree > max_degree)
+            max_degree = degree;
+    }
+
+    T->peer_node = (int *)malloc(sizeof(int) * (T->peer_offset[nodes] + 1));
+
+    for (int i = 0; i < nodes; i++)
+    {
+        int k = T->peer_offset[i];
+        for (int j = 0; j < nodes; j++)
+        {
+            if (i != j && get_edge(G, i, j) != NO_CONNECTION)
+                T->peer_node[k++] = j;
+        }
+    }
+
+    // Code 0 is the router itself and the last code marks an unknown hop
+    T->hop_width = max_degree + 2 <= 0xFF ? 1 : 2;
+    T->hops = (uint8_t *)calloc((size_t)nodes * nodes, T->hop_width);
+
+    T->dist_width = 1;
+    T->dists = (uint8_t *)calloc((size_t)nodes * nodes, 1);
+    T->dict_size = 0;
+    T->dict = (int *)malloc(sizeof(int) * ROUTE_TABLE_DICT_MAX);
+    T->dict_slots = (int *)calloc(2 * ROUTE_TABLE_DICT_MAX, sizeof(int));
+    T->dict_keys = (int *)malloc(sizeof(int) * 2 * ROUTE_TABLE_DICT_MAX);
+
+    return T;
+}
+
+/**
+ * @brief function reading a code of the given width
+ *
+ * @param codes array of codes
+ * @param width bytes per code
+ * @param cell index of the code
+ * @return int value of the code
+ */
+int route_table_code(const uint8_t *codes, int width, size_t cell)
+{
+    if (width == 1)
+        return codes[cell];
+    if (width == 2)
+        return ((const uint16_t *)codes)[cell];
+    return ((const int32_t *)codes)[cell];
+}
+
+/**
+ * @brief function writing a code of the given width
+ *
+ * @param codes array of codes
+ * @param width bytes per code
+ * @param cell index of the code
+ * @param value value of the code
+ */
+void route_table_put_code(uint8_t *codes, int width, size_t cell, int value)
+{
+    if (width == 1)
+        codes[cell] = (uint8_t)value;
+    else if (width == 2)
+        ((uint16_t *)codes)[cell] = (uint16_t)value;
+    else
+        ((int32_t *)codes)[cell] = value;
+}
+
+/**
+ * @brief function widening the distance codes once the dictionary outgrows them
+ *
+ * @param T pointer to the store
+ * @param width new bytes per code, 4 replaces codes with raw distances
+ */
+void route_table_widen(struct route_table *T, int width)
+{
+    size_t cells = (size_t)T->nodes * T->nodes;
+    uint8_t *wider = (uint8_t *)malloc(cells * width);
+
+    for (size_t cell = 0; cell < cells; cell++)
+    {
+        int code = route_table_code(T->dists, T->dist_width, cell);
+        route_table_put_code(wider, width, cell, width == 4 ? T->dict[code] : code);
+    }
+
+    free(T->dists);
+    T->dists = wider;
+    T->dist_width = width;
+}
+
+/**
+ * @brief function encoding a distance, adding it to the dictionary if needed
+ *
+ * @param T pointer to the store
+ * @param distance distance to be encoded
+ * @return int code of the distance (the distance itself for raw storage)
+ */
+int route_table_encode_distance(struct route_table *T, int distance)
+{
+    if (T->dist_width == 4)
+        return distance;
+
+    unsigned int mask = 2 * ROUTE_TABLE_DICT_MAX - 1;
+    unsigned int slot = ((unsigned int)distance * 2654435761u) & mask;
+
+    while (T->dict_slots[slot] != 0)
+    {
+        if (T->dict_keys[slot] == distance)
+            return T->dict_slots[slot] - 1;
+        slot = (slot + 1) & mask;
+    }
+
+    if (T->dict_size == ROUTE_TABLE_DICT_MAX)
+    {
+        route_table_widen(T, 4);
+        return distance;
+    }
+
+    if (T->dict_size == 0x100 && T->dist_width == 1)
+    {
+        route_table_widen(T, 2);
+    }
+
+    T->dict[T->dict_size] = distance;
+    T->dict_keys[slot] = distance;
+    T->dict_slots[slot] = T->dict_size + 1;
+
+    return T->dict_size++;
+}
+
+/**
+ * @brief function storing the routing table of one router
+ *
+ * @param T pointer to the store
+ * @param source node ID of the router
+ * @param next_hop array mapping node IDs to the next hop node IDs
+ * @param distance array of distances to each node
+ */
+void route_table_set_row(struct route_table *T, int source, const int *next_hop, const int *distance)
+{
+    int first = T->peer_offset[source];
+    int degree = T->peer_offset[source + 1] - first;
+    int unknown = degree + 1;
+    size_t row = (size_t)source * T->nodes;
+
+    for (int i = 0; i < T->nodes; i++)
+    {
+        int code = unknown;
+
+        if (next_hop[i] == source)
+        {
+            code = 0;
+        }
+        else
+        {
+            // Peers are sorted, binary search for the next hop
+            int lo = 0, hi = degree - 1;
+            while (lo <= hi)
+            {
+                int mid = (lo + hi) / 2;
+                int peer = T->peer_node[first + mid];
+                if (peer == next_hop[i])
+                {
+                    code = mid + 1;
+                    break;
+                }
+                if (peer < next_hop[i])
+                    lo = mid + 1;
+                else
+                    hi = mid - 1;
+            }
+        }
+
+        route_table_put_code(T->hops, T->hop_width, row + i, code);
+
+        int dist_code = route_table_encode_distance(T, distance[i]);
+        route_table_put_code(T->dists, T->dist_width, row + i, dist_code);
+    }
+}
+
+/**
+ * @brief function getting the next hop of a route
+ *
+ * @param T pointer to the store
+ * @param source node ID of the router
+ * @param destination node ID of the destination
+ * @return int node ID of the next hop, ROUTE_TABLE_NO_HOP if unknown
+ */
+int route_table_next_hop(const struct route_table *T, int source, int destination)
+{
+    int code = route_table_code(T->hops, T->hop_width, (size_t)source * T->nodes + destination);
+
+    if (code == 0)
+        return source;
+
+    int first = T->peer_offset[source];
+    if (code > T->peer_offset[source + 1] - first)
+        return ROUTE_TABLE_NO_HOP;
+
+    return T->peer_node[first + code - 1];
+}
+
+/**
+ * @brief function getting the distance of a route
+ *
+ * @param T pointer to the store
+ * @param source node ID of the router
+ * @param destination node ID of the destination
+ * @return int distance to the destination
+ */
+int route_table_distance(const struct route_table *T, int source, int destination)
+{
+    int code = route_table_code(T->dists, T->dist_width, (size_t)source * T->nodes + destination);
+
+    if (T->dist_width == 4)
+        return code;
+
+    return T->dict[code];
+}
+
+/**
+ * @brief function computing the memory used by the store
+ *
+ * @param T pointer to the store
+ * @return size_t number of bytes held by the store
+ */
+size_t route_table_bytes(const struct route_table *T)
+{
+    size_t cells = (size_t)T->nodes * T->nodes;
+
+    return sizeof(struct route_table) +
+           sizeof(int) * T->nodes +
+           sizeof(int) * (T->nodes + 1) +
+           sizeof(int) * T->peer_offset[T->nodes] +
+           cells * T->hop_width +
+           cells * T->dist_width +
+           sizeof(int) * T->dict_size;
+}
+
+/**
+ * @brief function releasing the dictionary hash table once all rows are stored
+ *
+ * @param T pointer to the store
+ */
+void route_table_seal(struct route_table *T)
+{
+    free(T->dict_slots);
+    free(T->dict_keys);
+    T->dict_slots = NULL;
+    T->dict_keys = NULL;
+
+    T->dict = (int *)realloc(T->dict, sizeof(int) * (T->dict_size + 1));
+}
+
+/**
+ * @brief function freeing the store
+ *
+ * @param T pointer to the store
+ */
+void free_route_table(struct route_table *T)
+{
+    if (T == NULL)
+        return;
+
+    free(T->as_map);
+    free(T->peer_offset);
+    free(T->peer_node);
+    free(T->hops);
+    free(T->dists);
+    free(T->dict);
+    free(T->dict_slots);
+    free(T->dict_keys);
+    free(T);
+}
+
+#endif
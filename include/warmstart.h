@@ -0,0 +1,427 @@
+/**
+ * @file warmstart.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief shortest paths warm started from the results of a neighbouring router
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef WARMSTART_H
+#define WARMSTART_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "bellford.h"
+#include "graph.h"
+#include "network.h"
+#include "router.h"
+
+/*
+
+If S' has an edge to S with cost W then d(S', V) <= W + d(S, V) for every V,
+so the distances of S shifted by W are valid upper bounds for S'. They already
+satisfy d(U) + cost(U, V) >= d(V) for every edge except around S' itself,
+so a queue based relaxation started only from S' performs just the corrective
+relaxations instead of V - 1 passes over all edges.
+
+*/
+
+#define WARM_CACHE_SIZE 16
+
+/**
+ * @brief structure representing the counters of the warm start engine
+ *
+ * @param sources number of computed sources
+ * @param warm_sources number of sources seeded from a neighbour
+ * @param warm_scans edges scanned by warm started sources
+ * @param cold_scans edges scanned by sources started from scratch
+ * @param improvements number of distance improvements
+ * @param bellman_scans edges bellman_ford() would have scanned for the same sources
+ */
+struct warm_stats {
+    long sources;
+    long warm_sources;
+    long warm_scans;
+    long cold_scans;
+    long improvements;
+    long bellman_scans;
+};
+
+/**
+ * @brief structure representing a cached result of a computed source
+ *
+ * @param source node ID of the source, -1 for an empty entry
+ * @param distance distances from the source
+ * @param predecessor predecessors on the shortest paths from the source
+ */
+struct warm_entry {
+    int source;
+    int *distance;
+    int *predecessor;
+};
+
+/**
+ * @brief structure representing the warm start engine
+ *
+ * @param out outgoing edges of every node
+ * @param cache results of the most recently computed sources
+ * @param cache_next next cache entry to be replaced
+ * @param queue circular queue of nodes to be relaxed
+ * @param queued 1 for nodes currently in the queue
+ * @param enqueued number of times every node entered the queue
+ * @param stats counters of the engine
+ */
+struct warm_engine {
+    struct adjacency *out;
+    struct warm_entry cache[WARM_CACHE_SIZE];
+    int cache_next;
+    int *queue;
+    char *queued;
+    int *enqueued;
+    struct warm_stats stats;
+};
+
+/**
+ * @brief function initializing the warm start engine
+ *
+ * @param G pointer to the graph
+ * @return struct warm_engine* pointer to the initialized engine
+ */
+struct warm_engine *init_warm_engine(struct graph *G)
+{
+    struct warm_engine *W = (struct warm_engine *)calloc(1, sizeof(struct warm_engine));
+    int nodes = G->nodes;
+
+    W->out = extract_adjacency(G, 0);
+
+    for (int i = 0; i < WARM_CACHE_SIZE; i++)
+    {
+        W->cache[i].source = -1;
+        W->cache[i].distance = (int *)malloc(sizeof(int) * nodes);
+        W->cache[i].predecessor = (int *)malloc(sizeof(int) * nodes);
+    }
+
+    W->queue = (int *)malloc(sizeof(int) * nodes);
+    W->queued = (char *)calloc(nodes, 1);
+    W->enqueued = (int *)calloc(nodes, sizeof(int));
+
+    return W;
+}
+
+/**
+ * @brief function ordering the routers of a process so consecutive routers are mostly peers
+ * @details Nodes are numbered in depth first order of a spanning forest (links are treated
+ * as undirected) and every process gets a contiguous block of that order
+ *
+ * @param G pointer to the graph
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @param count pointer to the number of routers of the process
+ * @return int* node IDs of the routers of the process, in computation order
+ */
+int *warm_schedule(struct graph *G, int rank, int size, int *count)
+{
+    int nodes = G->nodes;
+    int *order = (int *)malloc(sizeof(int) * nodes);
+    int *stack = (int *)malloc(sizeof(int) * nodes);
+    int *scan = (int *)calloc(nodes, sizeof(int));
+    char *visited = (char *)calloc(nodes, 1);
+    int ordered = 0;
+
+    for (int root = 0; root < nodes; root++)
+    {
+        if (visited[root])
+            continue;
+
+        int depth = 0;
+        stack[depth++] = root;
+        visited[root] = 1;
+        order[ordered++] = root;
+
+        while (depth > 0)
+        {
+            int u = stack[depth - 1];
+
+            // Continue scanning the neighbours of u where we left off
+            while (scan[u] < nodes)
+            {
+                int v = scan[u]++;
+                if (!visited[v] && (get_edge(G, u, v) != NO_CONNECTION || get_edge(G, v, u) != NO_CONNECTION))
+                {
+                    visited[v] = 1;
+                    order[ordered++] = v;
+                    stack[depth++] = v;
+                    break;
+                }
+            }
+
+            if (scan[u] == nodes && stack[depth - 1] == u)
+                depth--;
+        }
+    }
+
+    int first = (int)((long)nodes * rank / size);
+    int last = (int)((long)nodes * (rank + 1) / size);
+
+    *count = last - first;
+    int *mine = (int *)malloc(sizeof(int) * (*count + 1));
+    memcpy(mine, order + first, sizeof(int) * (*count));
+
+    free(order);
+    free(stack);
+    free(scan);
+    free(visited);
+
+    return mine;
+}
+
+/**
+ * @brief function adding a node to the relaxation queue
+ *
+ * @param W pointer to the engine
+ * @param head pointer to the queue head
+ * @param length pointer to the queue length
+ * @param node node to be added
+ * @return int 1 if the node entered the queue more than nodes times (negative cycle)
+ */
+int warm_push(struct warm_engine *W, int head, int *length, int node)
+{
+    int nodes = W->out->nodes;
+
+    if (W->queued[node])
+        return 0;
+
+    W->queued[node] = 1;
+    W->queue[(head + *length) % nodes] = node;
+    (*length)++;
+
+    return ++W->enqueued[node] > nodes;
+}
+
+/**
+ * @brief function computing shortest paths, seeded from a cached neighbour when possible
+ *
+ * @param W pointer to the engine
+ * @param G pointer to the graph
+ * @param source_id ID of the source node
+ * @return struct bellman_results results, same as bellman_ford() would return
+ */
+struct bellman_results warm_shortest_paths(struct warm_engine *W, struct graph *G, int source_id)
+{
+    int nodes = G->nodes;
+    int *distances = (int *)malloc(sizeof(int) * nodes);
+    int *predecessor = (int *)malloc(sizeof(int) * nodes);
+
+    // Pick the cheapest cached neighbour reachable over a direct edge
+    struct warm_entry *seed = NULL;
+    int seed_cost = 0;
+
+    for (int i = 0; i < WARM_CACHE_SIZE; i++)
+    {
+        int cached = W->cache[i].source;
+        if (cached < 0 || cached == source_id)
+            continue;
+
+        int cost = get_edge(G, source_id, cached);
+        if (cost != NO_CONNECTION && (seed == NULL || cost < seed_cost))
+        {
+            seed = &W->cache[i];
+            seed_cost = cost;
+        }
+    }
+
+    if (seed != NULL)
+    {
+        for (int v = 0; v < nodes; v++)
+        {
+            if (seed->distance[v] >= INFINITY)
+            {
+                distances[v] = INFINITY;
+                predecessor[v] = NULL_PREDECESSOR;
+                continue;
+            }
+
+            distances[v] = seed_cost + seed->distance[v];
+            predecessor[v] = seed->predecessor[v];
+
+            // The bound does not fit below INFINITY, it would break the invariant
+            if (distances[v] >= INFINITY)
+            {
+                seed = NULL;
+                break;
+            }
+        }
+    }
+
+    if (seed != NULL)
+    {
+        distances[seed->source] = seed_cost;
+        predecessor[seed->source] = source_id;
+        W->stats.warm_sources++;
+    }
+    else
+    {
+        for (int v = 0; v < nodes; v++)
+        {
+            distances[v] = INFINITY;
+            predecessor[v] = NULL_PREDECESSOR;
+        }
+    }
+
+    distances[source_id] = 0;
+    predecessor[source_id] = NULL_PREDECESSOR;
+
+    // Relax from the source until nothing improves
+    struct adjacency *A = W->out;
+    memset(W->enqueued, 0, sizeof(int) * nodes);
+
+    int head = 0;
+    int length = 0;
+    long scans = 0;
+    int negative_cycle = warm_push(W, head, &length, source_id);
+
+    while (length > 0 && !negative_cycle)
+    {
+        int u = W->queue[head];
+        head = (head + 1) % nodes;
+        length--;
+        W->queued[u] = 0;
+
+        for (int k = A->offset[u]; k < A->offset[u + 1]; k++)
+        {
+            int v = A->target[k];
+            scans++;
+
+            if (distances[u] + A->cost[k] < distances[v])
+            {
+                distances[v] = distances[u] + A->cost[k];
+                predecessor[v] = u;
+                W->stats.improvements++;
+
+                negative_cycle |= warm_push(W, head, &length, v);
+            }
+        }
+    }
+
+    if (negative_cycle)
+    {
+        printf("Graph contains a negative-weight cycle\n");
+
+        for (int v = 0; v < nodes; v++)
+            W->queued[v] = 0;
+    }
+
+    W->stats.sources++;
+    W->stats.bellman_scans += (long)nodes * A->edges;
+
+    if (seed != NULL)
+        W->stats.warm_scans += scans;
+    else
+        W->stats.cold_scans += scans;
+
+    // Remember the results for the following sources
+    struct warm_entry *slot = &W->cache[W->cache_next];
+    W->cache_next = (W->cache_next + 1) % WARM_CACHE_SIZE;
+
+    slot->source = source_id;
+    memcpy(slot->distance, distances, sizeof(int) * nodes);
+    memcpy(slot->predecessor, predecessor, sizeof(int) * nodes);
+
+    struct bellman_results returned_data;
+    returned_data.distance = distances;
+    returned_data.predecessor = predecessor;
+    returned_data.size = nodes;
+
+    return returned_data;
+}
+
+/**
+ * @brief function freeing the warm start engine
+ *
+ * @param W pointer to the engine
+ */
+void free_warm_engine(struct warm_engine *W)
+{
+    if (W == NULL)
+        return;
+
+    for (int i = 0; i < WARM_CACHE_SIZE; i++)
+    {
+        free(W->cache[i].distance);
+        free(W->cache[i].predecessor);
+    }
+
+    free_adjacency(W->out);
+    free(W->queue);
+    free(W->queued);
+    free(W->enqueued);
+    free(W);
+}
+
+/**
+ * @brief function summing the counters of all processes and printing them on node 0
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param stats pointer to the counters of the calling process
+ * @param rank rank of the calling process
+ */
+void report_warm_stats(struct warm_stats *stats, int rank)
+{
+    long local[6] = {stats->sources, stats->warm_sources, stats->warm_scans,
+                     stats->cold_scans, stats->improvements, stats->bellman_scans};
+    long total[6];
+
+    MPI_Reduce(local, total, 6, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank != 0)
+        return;
+
+    long cold_sources = total[0] - total[1];
+    double warm_avg = total[1] > 0 ? (double)total[2] / total[1] : 0.0;
+    double cold_avg = cold_sources > 0 ? (double)total[3] / cold_sources : 0.0;
+    long scans = total[2] + total[3];
+
+    printf("Warm start: %li sources, %li seeded from a peer, %li distance improvements\n", total[0], total[1], total[4]);
+    printf("Warm start: %.1f edge scans per warm source, %.1f per cold source\n", warm_avg, cold_avg);
+
+    printf("Warm start: %li edge scans, bellman_ford() would scan %li (%.1f%% saved)\n",
+           scans, total[5], total[5] > 0 ? 100.0 * (total[5] - scans) / total[5] : 0.0);
+}
+
+/**
+ * @brief function computing and describing the routers of a process with warm started shortest paths
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param size number of processes
+ */
+void run_warm_start(struct network *net, int rank, int size)
+{
+    struct warm_engine *W = init_warm_engine(net->netgraph);
+
+    int count;
+    int *order = warm_schedule(net->netgraph, rank, size, &count);
+
+    for (int k = 0; k < count; k++)
+    {
+        int i = order[k];
+        struct bellman_results res = warm_shortest_paths(W, net->netgraph, i);
+        struct router *rtr = routing_info_from_results(net->as_map[i], net->netgraph, net->as_map, net->names[i], res);
+        describe_router(rtr);
+        free_router(rtr);
+    }
+
+    report_warm_stats(&W->stats, rank);
+
+    free(order);
+    free_warm_engine(W);
+}
+
+#endif
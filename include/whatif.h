@@ -0,0 +1,833 @@
+/**
+ * @file whatif.h
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief batch what-if analysis of link failures and cost changes on top of one baseline computation
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef WHATIF_H
+#define WHATIF_H
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "ctype.h"
+
+#include "bellford.h"
+#include "graph.h"
+#include "network.h"
+#include "router.h"
+
+/*
+
+Scenario file, every scenario is applied to the baseline network on its own:
+
+SCENARIO name
+FAIL 10 20      link between AS 10 and AS 20 goes down in both directions
+COST 10 20 7    PEER 20 of router 10 gets cost 7 (added if it was not there)
+
+Within a scenario a later change of the same link replaces an earlier one.
+
+The baseline tables of all routers are computed once and shared by all
+processes. A source has to be recomputed for a scenario only if an edge whose
+cost went up is in its shortest path tree, or an edge whose cost went down
+relaxes one of its baseline distances. Otherwise its baseline tree is still
+a valid shortest path tree of the changed network.
+
+*/
+
+#define WHATIF_NAME_LENGTH 64
+
+/**
+ * @brief structure representing a single edge change
+ *
+ * @param from node ID of the router owning the PEER entry
+ * @param to node ID of the peer
+ * @param cost new cost, NO_CONNECTION for a removed edge
+ */
+struct whatif_change {
+    int from;
+    int to;
+    int cost;
+};
+
+/**
+ * @brief structure representing a list of scenarios
+ *
+ * @param count number of scenarios
+ * @param names names of the scenarios [SCENARIO * WHATIF_NAME_LENGTH]
+ * @param first index of the first change of every scenario, first[count] is the number of changes
+ * @param changes changes of all scenarios
+ */
+struct whatif_scenarios {
+    int count;
+    char *names;
+    int *first;
+    struct whatif_change *changes;
+};
+
+/**
+ * @brief function finding the node ID of an AS number
+ *
+ * @param net pointer to the network
+ * @param as_number AS number to be found
+ * @return int node ID, -1 if the AS is not in the network
+ */
+int whatif_node(struct network *net, int as_number)
+{
+    int node = node_of_as(net->as_map, net->router_count, as_number);
+
+    return net->as_map[node] == as_number ? node : -1;
+}
+
+/**
+ * @brief function adding a change to the current scenario, a later change of the same edge replaces the earlier one
+ *
+ * @param changes changes of all scenarios, with room for one more
+ * @param first index of the first change of the current scenario
+ * @param count pointer to the number of changes
+ * @param from node ID of the router owning the PEER entry
+ * @param to node ID of the peer
+ * @param cost new cost, NO_CONNECTION for a removed edge
+ */
+void whatif_add_change(struct whatif_change *changes, int first, int *count, int from, int to, int cost)
+{
+    int c = first;
+    while (c < *count && (changes[c].from != from || changes[c].to != to))
+        c++;
+
+    if (c == *count)
+        (*count)++;
+
+    changes[c].from = from;
+    changes[c].to = to;
+    changes[c].cost = cost;
+}
+
+/**
+ * @brief function reading scenarios from a file
+ * @warning Exits the program if the file can not be opened
+ *
+ * @param filename name of the scenario file
+ * @param net pointer to the network
+ * @return struct whatif_scenarios* pointer to the scenarios
+ */
+struct whatif_scenarios *whatif_from_file(const char *filename, struct network *net)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL)
+    {
+        printf("Cannot open scenario file %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    struct whatif_scenarios *S = (struct whatif_scenarios *)malloc(sizeof(struct whatif_scenarios));
+    int scenario_capacity = 16;
+    int change_capacity = 16;
+    int change_count = 0;
+
+    S->count = 0;
+    S->names = (char *)calloc(scenario_capacity, WHATIF_NAME_LENGTH);
+    S->first = (int *)malloc(sizeof(int) * (scenario_capacity + 1));
+    S->changes = (struct whatif_change *)malloc(sizeof(struct whatif_change) * change_capacity);
+
+    char *line = NULL;
+    size_t len = 0;
+
+    while (getline(&line, &len, fp) != -1)
+    {
+        char *token = strtok(line, " \t\r\n");
+        if (token == NULL)
+            continue;
+
+        if (strcmp(token, "SCENARIO") == 0)
+        {
+            if (S->count == scenario_capacity)
+            {
+                scenario_capacity *= 2;
+                S->names = (char *)realloc(S->names, (size_t)scenario_capacity * WHATIF_NAME_LENGTH);
+                S->first = (int *)realloc(S->first, sizeof(int) * (scenario_capacity + 1));
+            }
+
+            token = strtok(NULL, " \t\r\n");
+            char *name = S->names + (long)S->count * WHATIF_NAME_LENGTH;
+            snprintf(name, WHATIF_NAME_LENGTH, "%s", token ? token : "unnamed");
+
+            // The name becomes part of a file name in the working directory
+            for (char *c = name; *c != '\0'; c++)
+            {
+                if (!isalnum((unsigned char)*c) && *c != '-' && *c != '_' && *c != '.')
+                    *c = '_';
+            }
+
+            S->first[S->count++] = change_count;
+            continue;
+        }
+
+        int is_fail = strcmp(token, "FAIL") == 0;
+        if (!is_fail && strcmp(token, "COST") != 0)
+            continue;
+
+        char *from_token = strtok(NULL, " \t\r\n");
+        char *to_token = strtok(NULL, " \t\r\n");
+        char *cost_token = is_fail ? NULL : strtok(NULL, " \t\r\n");
+
+        if (S->count == 0 || from_token == NULL || to_token == NULL || (!is_fail && cost_token == NULL))
+        {
+            printf("Ignoring malformed scenario line\n");
+            continue;
+        }
+
+        int from = whatif_node(net, atoi(from_token));
+        int to = whatif_node(net, atoi(to_token));
+
+        if (from < 0 || to < 0 || from == to)
+        {
+            printf("Ignoring change of unknown link %s - %s\n", from_token, to_token);
+            continue;
+        }
+
+        if (change_count + 2 > change_capacity)
+        {
+            change_capacity *= 2;
+            S->changes = (struct whatif_change *)realloc(S->changes, sizeof(struct whatif_change) * change_capacity);
+        }
+
+        // Only the last change of an edge counts, the baseline cost is what gets restored
+        int first = S->first[S->count - 1];
+        whatif_add_change(S->changes, first, &change_count, from, to, is_fail ? NO_CONNECTION : atoi(cost_token));
+
+        if (is_fail)
+            whatif_add_change(S->changes, first, &change_count, to, from, NO_CONNECTION);
+    }
+
+    S->first[S->count] = change_count;
+
+    free(line);
+    fclose(fp);
+
+    return S;
+}
+
+/**
+ * @brief function reading scenarios on node 0 and broadcasting them to all nodes
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param filename name of the scenario file (only used on node 0)
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @return struct whatif_scenarios* scenarios shared by all processes
+ */
+struct whatif_scenarios *broadcast_scenarios(const char *filename, struct network *net, int rank)
+{
+    struct whatif_scenarios *S;
+    int sizes[2];
+
+    if (rank == 0)
+    {
+        S = whatif_from_file(filename, net);
+        sizes[0] = S->count;
+        sizes[1] = S->first[S->count];
+    }
+
+    MPI_Bcast(sizes, 2, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (rank != 0)
+    {
+        S = (struct whatif_scenarios *)malloc(sizeof(struct whatif_scenarios));
+        S->count = sizes[0];
+        S->names = (char *)malloc((size_t)(sizes[0] + 1) * WHATIF_NAME_LENGTH);
+        S->first = (int *)malloc(sizeof(int) * (sizes[0] + 1));
+        S->changes = (struct whatif_change *)malloc(sizeof(struct whatif_change) * (sizes[1] + 1));
+    }
+
+    MPI_Bcast(S->names, sizes[0] * WHATIF_NAME_LENGTH, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(S->first, sizes[0] + 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(S->changes, sizes[1] * 3, MPI_INT, 0, MPI_COMM_WORLD);
+
+    return S;
+}
+
+/**
+ * @brief function freeing the scenarios
+ *
+ * @param S pointer to the scenarios
+ */
+void free_scenarios(struct whatif_scenarios *S)
+{
+    if (S != NULL)
+    {
+        free(S->names);
+        free(S->first);
+        free(S->changes);
+        free(S);
+    }
+}
+
+/**
+ * @brief function computing the baseline tables of all routers, shared by all processes
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param rank rank of the calling process
+ * @param size number of processes
+ * @return int* rows of all routers [NODE * 3 * nodes], distances, next hops and predecessors
+ */
+int *whatif_baseline(struct network *net, int rank, int size)
+{
+    int nodes = net->router_count;
+    int row = 3 * nodes;
+    int owned = 0;
+
+    for (int i = rank; i < nodes; i += size)
+        owned++;
+
+    int *mine = (int *)malloc(sizeof(int) * ((long)owned * row + 1));
+    struct sssp_workspace *ws = init_sssp_workspace(net->netgraph);
+
+    for (int local = 0; local < owned; local++)
+    {
+        int source = rank + local * size;
+        int *out = mine + (long)local * row;
+
+        struct bellman_results res = bellman_ford_scratch(ws, NULL, source);
+
+        memcpy(out, res.distance, sizeof(int) * nodes);
+        compute_next_hops(out + nodes, nodes, source, res.predecessor);
+        memcpy(out + 2 * nodes, res.predecessor, sizeof(int) * nodes);
+
+        free(res.distance);
+        free(res.predecessor);
+
+        // The baseline tables are the regular output of the program
+        struct router *rtr = init_router(net->as_map[source], nodes, net->as_map, net->names[source]);
+        rtr->distance = out;
+        rtr->next_hop = out + nodes;
+        describe_router(rtr);
+        rtr->distance = NULL;
+        rtr->next_hop = NULL;
+        free_router(rtr);
+    }
+
+    free_sssp_workspace(ws);
+
+    // Rows arrive grouped by process, process R holds routers R, R + size...
+    // Counted in whole rows, 3 * nodes * owned integers do not fit an int
+    int *counts = (int *)malloc(sizeof(int) * size);
+    int *displs = (int *)malloc(sizeof(int) * size);
+    int offset = 0;
+
+    for (int r = 0; r < size; r++)
+    {
+        counts[r] = r < nodes ? (nodes - r + size - 1) / size : 0;
+        displs[r] = offset;
+        offset += counts[r];
+    }
+
+    MPI_Datatype row_type;
+    MPI_Type_contiguous(row, MPI_INT, &row_type);
+    MPI_Type_commit(&row_type);
+
+    int *grouped = (int *)malloc(sizeof(int) * ((long)nodes * row + 1));
+    MPI_Allgatherv(mine, owned, row_type, grouped, counts, displs, row_type, MPI_COMM_WORLD);
+    MPI_Type_free(&row_type);
+
+    int *baseline = (int *)malloc(sizeof(int) * ((long)nodes * row + 1));
+    for (int r = 0; r < size; r++)
+    {
+        for (int k = 0; k < counts[r]; k++)
+        {
+            memcpy(baseline + (long)(r + k * size) * row, grouped + (long)(displs[r] + k) * row, sizeof(int) * row);
+        }
+    }
+
+    free(grouped);
+    free(counts);
+    free(displs);
+    free(mine);
+
+    return baseline;
+}
+
+/**
+ * @brief function checking whether a scenario can change the routes of a source
+ *
+ * @param G pointer to the baseline graph
+ * @param base baseline row of the source
+ * @param nodes number of routers in the network
+ * @param changes changes of the scenario
+ * @param change_count number of changes
+ * @return int 1 if the source has to be recomputed
+ */
+int whatif_affects(struct graph *G, const int *base, int nodes, const struct whatif_change *changes, int change_count)
+{
+    const int *distance = base;
+    const int *predecessor = base + 2 * nodes;
+
+    for (int c = 0; c < change_count; c++)
+    {
+        int from = changes[c].from;
+        int to = changes[c].to;
+        int old_cost = get_edge(G, from, to);
+        int new_cost = changes[c].cost;
+
+        // A more expensive edge matters only if the tree uses it
+        if (new_cost > old_cost && predecessor[to] == from)
+            return 1;
+
+        // A cheaper edge matters only if it relaxes a baseline distance
+        if (new_cost < old_cost && distance[from] + new_cost < distance[to])
+            return 1;
+    }
+
+    return 0;
+}
+#define WHATIF_UNKNOWN 0
+#define WHATIF_KEPT 1
+#define WHATIF_INVALID 2
+
+/**
+ * @brief structure representing the scratch data used to repair baseline trees
+ *
+ * @param nodes number of routers in the network
+ * @param out outgoing edges of the baseline graph
+ * @param in incoming edges of the baseline graph
+ * @param distance repaired distances
+ * @param predecessor repaired predecessors
+ * @param next_hop repaired next hops
+ * @param state WHATIF_* state of every node, or 1 for nodes with a known next hop
+ * @param stack nodes waiting for the state of their predecessor
+ * @param queue nodes whose distance went down (circular)
+ * @param queued 1 for nodes in the queue
+ * @param updates number of times every node was queued, to detect negative cycles
+ */
+struct whatif_engine {
+    int nodes;
+    struct adjacency *out;
+    struct adjacency *in;
+    int *distance;
+    int *predecessor;
+    int *next_hop;
+    char *state;
+    int *stack;
+    int *queue;
+    char *queued;
+    int *updates;
+};
+
+/**
+ * @brief function initializing the repair scratch data for the baseline graph
+ *
+ * @param G pointer to the baseline graph
+ * @return struct whatif_engine* pointer to the engine
+ */
+struct whatif_engine *init_whatif_engine(struct graph *G)
+{
+    struct whatif_engine *W = (struct whatif_engine *)malloc(sizeof(struct whatif_engine));
+    int nodes = G->nodes;
+
+    W->nodes = nodes;
+    W->out = extract_adjacency(G, 0);
+    W->in = extract_adjacency(G, 1);
+    W->distance = (int *)malloc(sizeof(int) * nodes);
+    W->predecessor = (int *)malloc(sizeof(int) * nodes);
+    W->next_hop = (int *)malloc(sizeof(int) * nodes);
+    W->state = (char *)malloc(nodes);
+    W->stack = (int *)malloc(sizeof(int) * nodes);
+    W->queue = (int *)malloc(sizeof(int) * (nodes + 1));
+    W->queued = (char *)calloc(nodes, 1);
+    W->updates = (int *)malloc(sizeof(int) * nodes);
+
+    return W;
+}
+
+/**
+ * @brief function freeing the repair scratch data
+ *
+ * @param W pointer to the engine
+ */
+void free_whatif_engine(struct whatif_engine *W)
+{
+    free_adjacency(W->out);
+    free_adjacency(W->in);
+    free(W->distance);
+    free(W->predecessor);
+    free(W->next_hop);
+    free(W->state);
+    free(W->stack);
+    free(W->queue);
+    free(W->queued);
+    free(W->updates);
+    free(W);
+}
+
+/**
+ * @brief function lowering the distance of a node and queueing it
+ *
+ * @param W pointer to the engine
+ * @param node node reached
+ * @param via predecessor of the node
+ * @param distance new distance of the node
+ * @param tail pointer to the tail of the queue
+ * @return int 1 if the node was queued more often than there are nodes (negative cycle)
+ */
+int whatif_improve(struct whatif_engine *W, int node, int via, int distance, int *tail)
+{
+    W->distance[node] = distance;
+    W->predecessor[node] = via;
+
+    if (!W->queued[node])
+    {
+        // In FIFO order a node is queued at most once per pass
+        if (++W->updates[node] > W->nodes)
+            return 1;
+
+        W->queued[node] = 1;
+        W->queue[*tail] = node;
+        *tail = (*tail + 1) % (W->nodes + 1);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief function repairing the baseline tree of a source after the changes of a scenario
+ * @details Nodes below a tree edge that got more expensive lose their distance and are seeded
+ * from their other peers, then everything that improved is relaxed again in FIFO order
+ *
+ * @param W pointer to the engine
+ * @param G pointer to the graph with the changes applied
+ * @param source source node ID
+ * @param base baseline row of the source
+ * @param changes changes of the scenario
+ * @param old_costs costs of the changed edges before the scenario
+ * @param change_count number of changes
+ * @return int 0 on success, 1 if the changes created a negative cycle
+ */
+int whatif_repair(struct whatif_engine *W, struct graph *G, int source, const int *base,
+                  const struct whatif_change *changes, const int *old_costs, int change_count)
+{
+    int nodes = W->nodes;
+    int *distance = W->distance;
+    int *predecessor = W->predecessor;
+    int head = 0;
+    int tail = 0;
+    int invalid = 0;
+    int status = 0;
+
+    memcpy(distance, base, sizeof(int) * nodes);
+    memcpy(predecessor, base + 2 * nodes, sizeof(int) * nodes);
+    memset(W->state, WHATIF_UNKNOWN, nodes);
+    memset(W->updates, 0, sizeof(int) * nodes);
+
+    W->state[source] = WHATIF_KEPT;
+
+    for (int c = 0; c < change_count; c++)
+    {
+        if (changes[c].cost > old_costs[c] && predecessor[changes[c].to] == changes[c].from)
+        {
+            W->state[changes[c].to] = WHATIF_INVALID;
+            invalid = 1;
+        }
+    }
+
+    if (invalid)
+    {
+        // A node is invalid if its tree path goes through the root of an invalid subtree
+        for (int v = 0; v < nodes; v++)
+        {
+            int depth = 0;
+            int x = v;
+
+            while (W->state[x] == WHATIF_UNKNOWN && predecessor[x] != NULL_PREDECESSOR)
+            {
+                W->stack[depth++] = x;
+                x = predecessor[x];
+            }
+
+            char state = W->state[x] == WHATIF_UNKNOWN ? WHATIF_KEPT : W->state[x];
+            W->state[x] = state;
+
+            while (depth > 0)
+                W->state[W->stack[--depth]] = state;
+        }
+
+        for (int v = 0; v < nodes; v++)
+        {
+            if (W->state[v] == WHATIF_INVALID)
+            {
+                distance[v] = INFINITY;
+                predecessor[v] = NULL_PREDECESSOR;
+            }
+        }
+
+        for (int v = 0; v < nodes; v++)
+        {
+            if (W->state[v] != WHATIF_INVALID)
+                continue;
+
+            int best = INFINITY;
+            int via = NULL_PREDECESSOR;
+
+            for (int k = W->in->offset[v]; k < W->in->offset[v + 1]; k++)
+            {
+                int u = W->in->target[k];
+                int cost = get_edge(G, u, v);
+
+                if (cost != NO_CONNECTION && distance[u] < INFINITY && distance[u] + cost < best)
+                {
+                    best = distance[u] + cost;
+                    via = u;
+                }
+            }
+
+            // Edges added by the scenario are not in the baseline lists
+            for (int c = 0; c < change_count; c++)
+            {
+                int u = changes[c].from;
+                if (changes[c].to == v && changes[c].cost != NO_CONNECTION && distance[u] < INFINITY && distance[u] + changes[c].cost < best)
+                {
+                    best = distance[u] + changes[c].cost;
+                    via = u;
+                }
+            }
+
+            if (via != NULL_PREDECESSOR)
+                status |= whatif_improve(W, v, via, best, &tail);
+        }
+    }
+
+    for (int c = 0; c < change_count; c++)
+    {
+        int u = changes[c].from;
+        int v = changes[c].to;
+
+        if (changes[c].cost < old_costs[c] && distance[u] < INFINITY && distance[u] + changes[c].cost < distance[v])
+        {
+            status |= whatif_improve(W, v, u, distance[u] + changes[c].cost, &tail);
+        }
+    }
+
+    // On a negative cycle the queue is only drained
+
+    while (head != tail)
+    {
+        int u = W->queue[head];
+        head = (head + 1) % (nodes + 1);
+        W->queued[u] = 0;
+
+        if (status)
+            continue;
+
+        for (int k = W->out->offset[u]; k < W->out->offset[u + 1]; k++)
+        {
+            int v = W->out->target[k];
+            int cost = get_edge(G, u, v);
+
+            if (cost != NO_CONNECTION && distance[u] + cost < distance[v])
+                status |= whatif_improve(W, v, u, distance[u] + cost, &tail);
+        }
+
+        for (int c = 0; c < change_count; c++)
+        {
+            int v = changes[c].to;
+
+            if (changes[c].from == u && changes[c].cost != NO_CONNECTION && distance[u] + changes[c].cost < distance[v])
+                status |= whatif_improve(W, v, u, distance[u] + changes[c].cost, &tail);
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief function computing the next hops of the repaired tree without the fixpoint of compute_next_hops
+ *
+ * @param W pointer to the engine
+ * @param source source node ID
+ */
+void whatif_next_hops(struct whatif_engine *W, int source)
+{
+    int nodes = W->nodes;
+    const int *predecessor = W->predecessor;
+
+    memset(W->state, 0, nodes);
+    W->state[source] = 1;
+    W->next_hop[source] = source;
+
+    for (int v = 0; v < nodes; v++)
+    {
+        int depth = 0;
+        int x = v;
+
+        while (!W->state[x] && predecessor[x] != source && predecessor[x] != NULL_PREDECESSOR)
+        {
+            W->stack[depth++] = x;
+            x = predecessor[x];
+        }
+
+        if (!W->state[x])
+        {
+            W->next_hop[x] = x;
+            W->state[x] = 1;
+        }
+
+        while (depth > 0)
+        {
+            int y = W->stack[--depth];
+            W->next_hop[y] = W->next_hop[x];
+            W->state[y] = 1;
+        }
+    }
+}
+
+/**
+ * @brief function running one scenario and writing the differences from the baseline to a file
+ *
+ * @param W pointer to the repair engine
+ * @param net pointer to the network, its graph is changed and restored
+ * @param S pointer to the scenarios
+ * @param scenario index of the scenario
+ * @param baseline baseline rows of all routers
+ * @param repaired pointer to the counter of repaired sources
+ * @param changed pointer to the counter of changed routes
+ */
+void run_scenario(struct whatif_engine *W, struct network *net, struct whatif_scenarios *S, int scenario, const int *baseline, long *repaired, long *changed)
+{
+    int nodes = net->router_count;
+    int row = 3 * nodes;
+    struct graph *G = net->netgraph;
+    const struct whatif_change *changes = S->changes + S->first[scenario];
+    int change_count = S->first[scenario + 1] - S->first[scenario];
+    const char *name = S->names + (long)scenario * WHATIF_NAME_LENGTH;
+
+    char file[128 + WHATIF_NAME_LENGTH] = "";
+    sprintf(file, "./WHATIF_%s.txt", name);
+
+    FILE *fp = fopen(file, "w");
+    if (fp == NULL)
+    {
+        printf("Cannot write %s, skipping scenario %s\n", file, name);
+        return;
+    }
+
+    char *affected = (char *)calloc(nodes, 1);
+    int affected_count = 0;
+
+    for (int s = 0; s < nodes; s++)
+    {
+        affected[s] = whatif_affects(G, baseline + (long)s * row, nodes, changes, change_count);
+        affected_count += affected[s];
+    }
+
+    int *old_costs = (int *)malloc(sizeof(int) * (change_count + 1));
+    for (int c = 0; c < change_count; c++)
+    {
+        old_costs[c] = get_edge(G, changes[c].from, changes[c].to);
+        set_edge(G, changes[c].from, changes[c].to, changes[c].cost);
+    }
+
+    fprintf(fp, "Scenario %s\n", name);
+
+    for (int c = 0; c < change_count; c++)
+    {
+        fprintf(fp, "LINK %i %i COST %i -> %i\n", net->as_map[changes[c].from], net->as_map[changes[c].to], old_costs[c], changes[c].cost);
+    }
+
+    fprintf(fp, "REPAIRED %i OF %i ROUTERS\n", affected_count, nodes);
+
+    for (int s = 0; s < nodes; s++)
+    {
+        if (!affected[s])
+            continue;
+
+        const int *base = baseline + (long)s * row;
+
+        if (whatif_repair(W, G, s, base, changes, old_costs, change_count))
+        {
+            fprintf(fp, " AS %i NEGATIVE CYCLE\n", net->as_map[s]);
+            continue;
+        }
+
+        whatif_next_hops(W, s);
+
+        for (int t = 0; t < nodes; t++)
+        {
+            if (t == s || (W->distance[t] == base[t] && W->next_hop[t] == base[nodes + t]))
+                continue;
+
+            fprintf(fp, " AS %i TO %i VIA %i DIST %i -> VIA %i DIST %i (%+i)\n",
+                    net->as_map[s], net->as_map[t],
+                    net->as_map[base[nodes + t]], base[t],
+                    net->as_map[W->next_hop[t]], W->distance[t],
+                    W->distance[t] - base[t]);
+            (*changed)++;
+        }
+    }
+
+    fclose(fp);
+
+    for (int c = change_count - 1; c >= 0; c--)
+    {
+        set_edge(G, changes[c].from, changes[c].to, old_costs[c]);
+    }
+
+    *repaired += affected_count;
+
+    free(old_costs);
+    free(affected);
+}
+
+/**
+ * @brief function running all scenarios of a file against one baseline computation
+ * @warning This function is collective, every process in MPI_COMM_WORLD has to call it
+ *
+ * @param net pointer to the network
+ * @param filename name of the scenario file (only used on node 0)
+ * @param rank rank of the calling process
+ * @param size number of processes
+ */
+void run_what_if(struct network *net, const char *filename, int rank, int size)
+{
+    double start = MPI_Wtime();
+
+    struct whatif_scenarios *S = broadcast_scenarios(filename, net, rank);
+    int *baseline = whatif_baseline(net, rank, size);
+
+    double baseline_time = MPI_Wtime() - start;
+
+    // Scenarios are spread like routers, every process writes the diffs of its own
+    struct whatif_engine *W = init_whatif_engine(net->netgraph);
+    long counts[2] = {0, 0};
+
+    for (int k = rank; k < S->count; k += size)
+    {
+        run_scenario(W, net, S, k, baseline, &counts[0], &counts[1]);
+    }
+
+    free_whatif_engine(W);
+
+    double times[2] = {baseline_time, MPI_Wtime() - start - baseline_time};
+    double slowest[2];
+    long totals[2];
+
+    MPI_Reduce(counts, totals, 2, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(times, slowest, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        printf("What-if: %i scenarios, %li of %li router tables repaired, %li routes changed\n",
+               S->count, totals[0], (long)S->count * net->router_count, totals[1]);
+        printf("What-if: baseline %.3f s, all scenarios %.3f s (slowest process)\n", slowest[0], slowest[1]);
+    }
+
+    free(baseline);
+    free_scenarios(S);
+}
+
+#endif
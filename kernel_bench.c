@@ -0,0 +1,493 @@
+/**
+ * @file kernel_bench.c
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief microbenchmarks of the parser, graph and routing kernels
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "fcntl.h"
+#include "unistd.h"
+
+#include "arena.h"
+#include "bellford.h"
+#include "configchain.h"
+#include "graph.h"
+#include "router.h"
+
+/*
+
+Usage: kernel_bench [routers] [degree] [repetitions] [seed] > bench.json
+
+Every kernel runs on a synthetic configuration of routers with degree random
+peers each (plus a ring, so every router is reachable). A kernel first runs
+for the warm-up, the number of operations per repetition is then picked so one
+repetition takes at least BENCH_MIN_NS, and the time per operation of every
+repetition goes into the statistics. Allocations are counted by the
+ALLOC_STATS wrappers of arena.h over the measured repetitions only.
+
+The kernels print their debug output and write AS files as in the main
+program: stdout is sent to /dev/null and the benchmark runs in a temporary
+directory, the JSON report goes to the original stdout.
+
+*/
+
+#define BENCH_WARMUP 2
+#define BENCH_MIN_NS 20000000L
+#define BENCH_MAX_OPS 1000000L
+#define BENCH_AS_BASE 1000
+
+/**
+ * @brief structure representing the synthetic input shared by all kernels
+ *
+ * @param config_file path of the generated configuration
+ * @param routers number of routers
+ * @param edges number of links in the configuration
+ * @param G graph parsed from the configuration
+ * @param as_map array mapping node IDs to AS numbers
+ * @param predecessor shortest path predecessors of every router, for the next hop kernel
+ * @param next_hop scratch array of the next hop kernel
+ * @param rtr router written by the describe_router kernel
+ * @param sink value depending on every result, so nothing is optimized away
+ */
+struct bench_input {
+    char config_file[256];
+    int routers;
+    int edges;
+    struct graph *G;
+    int *as_map;
+    int **predecessor;
+    int *next_hop;
+    struct router *rtr;
+    long sink;
+};
+
+/**
+ * @brief structure representing a benchmarked kernel
+ *
+ * @param name name of the kernel in the report
+ * @param run function running operation op of the kernel
+ * @param edges function returning the edges handled by one operation
+ */
+struct bench_kernel {
+    const char *name;
+    void (*run)(struct bench_input *in, long op);
+    long (*edges)(struct bench_input *in);
+};
+
+/**
+ * @brief function returning the monotonic time in nanoseconds
+ *
+ * @return long current time
+ */
+long bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/**
+ * @brief function reading the allocation counters
+ *
+ * @param calls pointer to the number of allocations
+ * @param bytes pointer to the number of bytes requested
+ */
+void bench_alloc_counters(long *calls, long *bytes)
+{
+#ifdef ALLOC_STATS
+    *calls = __atomic_load_n(&alloc_stats_calls, __ATOMIC_RELAXED);
+    *bytes = __atomic_load_n(&alloc_stats_bytes, __ATOMIC_RELAXED);
+#else
+    *calls = -1;
+    *bytes = -1;
+#endif
+}
+
+/**
+ * @brief function writing a random configuration in the format of config_from_file
+ *
+ * @param filename path of the configuration
+ * @param routers number of routers
+ * @param degree number of random peers of every router
+ * @return int number of links written
+ */
+int bench_write_config(const char *filename, int routers, int degree)
+{
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL)
+        return -1;
+
+    char *linked = (char *)calloc(routers, 1);
+    int edges = 0;
+
+    for (int v = 0; v < routers; v++)
+    {
+        fprintf(fp, "ROUTER bench%i %i\n", v, BENCH_AS_BASE + v);
+
+        int next = (v + 1) % routers;
+        linked[next] = 1;
+        fprintf(fp, "PEER %i %i\n", BENCH_AS_BASE + next, 1 + rand() % 10);
+        edges++;
+
+        for (int d = 0; d < degree && d < routers - 2; d++)
+        {
+            int peer = rand() % routers;
+            if (peer == v || linked[peer])
+                continue;
+
+            linked[peer] = 1;
+            fprintf(fp, "PEER %i %i\n", BENCH_AS_BASE + peer, 1 + rand() % 10);
+            edges++;
+        }
+
+        fprintf(fp, "\n");
+        memset(linked, 0, routers);
+    }
+
+    free(linked);
+    fclose(fp);
+    return edges;
+}
+
+/**
+ * @brief function benchmarking parsing the configuration into the router chain
+ *
+ * @param in pointer to the input
+ * @param op number of the operation
+ */
+void bench_config_from_file(struct bench_input *in, long op)
+{
+    struct config_node *cfg = config_from_file(in->config_file);
+    in->sink += cfg->as_number + op;
+    free_node_chain(cfg);
+}
+
+/**
+ * @brief function benchmarking parsing the configuration into the graph
+ *
+ * @param in pointer to the input
+ * @param op number of the operation
+ */
+void bench_data_from_file(struct bench_input *in, long op)
+{
+    struct parsing_output *out = data_from_file(in->config_file);
+    in->sink += out->node_amount + op;
+
+    for (int i = 0; i < out->node_amount; i++)
+        free(out->names[i]);
+    free(out->names);
+    free(out->as_map);
+    free_graph(out->netgraph);
+    free(out);
+}
+
+/**
+ * @brief function benchmarking allocating an empty graph
+ *
+ * @param in pointer to the input
+ * @param op number of the operation
+ */
+void bench_init_graph(struct bench_input *in, long op)
+{
+    struct graph *G = init_graph(in->routers);
+    in->sink += G->costs[op % in->routers];
+    free_graph(G);
+}
+
+/**
+ * @brief function benchmarking copying the graph
+ *
+ * @param in pointer to the input
+ * @param op number of the operation
+ */
+void bench_copy_graph(struct bench_input *in, long op)
+{
+    struct graph *G = copy_graph(in->G);
+    in->sink += G->costs[op % in->routers];
+    free_graph(G);
+}
+
+/**
+ * @brief function benchmarking extracting the edge list from the cost matrix
+ *
+ * @param in pointer to the input
+ * @param op number of the operation
+ */
+void bench_extract_edges(struct bench_input *in, long op)
+{
+    int amount;
+    struct edge *E = extract_edges(in->G, &amount);
+    in->sink += amount + E[op % amount].cost;
+    free(E);
+}
+
+/**
+ * @brief function benchmarking computing the shortest paths from a router
+ *
+ * @param in pointer to the input
+ * @param op number of the operation
+ */
+void bench_bellman_ford(struct bench_input *in, long op)
+{
+    struct bellman_results res = bellman_ford(in->G, op % in->routers);
+    in->sink += res.distance[(op + 1) % in->routers];
+    free(res.distance);
+    free(res.predecessor);
+}
+
+/**
+ * @brief function benchmarking computing the next hops of a router from its predecessors
+ *
+ * @param in pointer to the input
+ * @param op number of the operation
+ */
+void bench_next_hops(struct bench_input *in, long op)
+{
+    int source = op % in->routers;
+    compute_next_hops(in->next_hop, in->routers, source, in->predecessor[source]);
+    in->sink += in->next_hop[(source + 1) % in->routers];
+}
+
+/**
+ * @brief function benchmarking writing the AS file of a router
+ *
+ * @param in pointer to the input
+ * @param op number of the operation
+ */
+void bench_describe_router(struct bench_input *in, long op)
+{
+    describe_router(in->rtr);
+    in->sink += op;
+}
+
+/**
+ * @brief function returning the links of the configuration as the edges of an operation
+ *
+ * @param in pointer to the input
+ * @return long number of edges
+ */
+long bench_config_edges(struct bench_input *in)
+{
+    return in->edges;
+}
+
+/**
+ * @brief function returning the relaxations of bellman_ford() as the edges of an operation
+ * @details Every pass relaxes every link, routers - 1 passes plus the negative cycle check
+ *
+ * @param in pointer to the input
+ * @return long number of edges
+ */
+long bench_relaxed_edges(struct bench_input *in)
+{
+    return (long)in->routers * in->edges;
+}
+
+/**
+ * @brief function returning the cells of the cost matrix as the edges of an operation
+ *
+ * @param in pointer to the input
+ * @return long number of edges
+ */
+long bench_matrix_edges(struct bench_input *in)
+{
+    return (long)in->routers * in->routers;
+}
+
+/**
+ * @brief function returning the entries of a routing table as the edges of an operation
+ *
+ * @param in pointer to the input
+ * @return long number of edges
+ */
+long bench_table_edges(struct bench_input *in)
+{
+    return in->routers;
+}
+
+/**
+ * @brief function comparing two doubles for qsort
+ *
+ * @param a pointer to the first double
+ * @param b pointer to the second double
+ * @return int negative, zero or positive as for strcmp
+ */
+int bench_compare(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief function benchmarking one kernel and writing its JSON object
+ *
+ * @param json report file
+ * @param K pointer to the kernel
+ * @param in pointer to the input
+ * @param repetitions number of measured repetitions
+ * @param last 1 if this is the last kernel of the report
+ */
+void bench_kernel(FILE *json, struct bench_kernel *K, struct bench_input *in, int repetitions, int last)
+{
+    long op = 0;
+    long start = bench_now();
+
+    for (int w = 0; w < BENCH_WARMUP; w++)
+        K->run(in, op++);
+
+    // Enough operations per repetition to be well above the timer resolution
+    long warmup_ns = (bench_now() - start) / BENCH_WARMUP;
+    long ops = warmup_ns > 0 ? BENCH_MIN_NS / warmup_ns + 1 : BENCH_MAX_OPS;
+    if (ops > BENCH_MAX_OPS)
+        ops = BENCH_MAX_OPS;
+
+    double *sample = (double *)malloc(sizeof(double) * repetitions);
+    long calls_before, bytes_before, calls_after, bytes_after;
+
+    bench_alloc_counters(&calls_before, &bytes_before);
+
+    for (int r = 0; r < repetitions; r++)
+    {
+        long begin = bench_now();
+        for (long o = 0; o < ops; o++)
+            K->run(in, op++);
+        sample[r] = (double)(bench_now() - begin) / ops;
+    }
+
+    bench_alloc_counters(&calls_after, &bytes_after);
+
+    // math.h is not included, its INFINITY clashes with bellford.h
+    double mean = 0;
+    for (int r = 0; r < repetitions; r++)
+        mean += sample[r];
+    mean /= repetitions;
+
+    double variance = 0;
+    for (int r = 0; r < repetitions; r++)
+        variance += (sample[r] - mean) * (sample[r] - mean);
+    variance = repetitions > 1 ? variance / (repetitions - 1) : 0;
+
+    qsort(sample, repetitions, sizeof(double), bench_compare);
+    double median = repetitions % 2 ? sample[repetitions / 2] : (sample[repetitions / 2 - 1] + sample[repetitions / 2]) / 2;
+
+    long measured = ops * repetitions;
+    double edges = (double)K->edges(in);
+
+    fprintf(json, "    {\"kernel\": \"%s\", \"ops_per_repetition\": %li, \"repetitions\": %i,\n", K->name, ops, repetitions);
+    fprintf(json, "     \"ns_per_op\": {\"min\": %.1f, \"median\": %.1f, \"mean\": %.1f, \"stddev\": %.1f, \"max\": %.1f},\n",
+            sample[0], median, mean, variance > 0 ? __builtin_sqrt(variance) : 0.0, sample[repetitions - 1]);
+    fprintf(json, "     \"edges_per_op\": %.0f, \"edges_per_s\": %.0f,\n", edges, median > 0 ? edges * 1e9 / median : 0.0);
+
+    if (calls_after >= 0)
+        fprintf(json, "     \"allocations_per_op\": %.2f, \"bytes_per_op\": %.1f}%s\n",
+                (double)(calls_after - calls_before) / measured, (double)(bytes_after - bytes_before) / measured, last ? "" : ",");
+    else
+        fprintf(json, "     \"allocations_per_op\": null, \"bytes_per_op\": null}%s\n", last ? "" : ",");
+
+    fflush(json);
+    free(sample);
+}
+
+int main(int argc, char **argv)
+{
+    int routers = argc > 1 ? atoi(argv[1]) : 500;
+    int degree = argc > 2 ? atoi(argv[2]) : 8;
+    int repetitions = argc > 3 ? atoi(argv[3]) : 10;
+    int seed = argc > 4 ? atoi(argv[4]) : 1;
+
+    if (routers < 3 || degree < 0 || repetitions < 1)
+    {
+        fprintf(stderr, "Usage: %s [routers] [degree] [repetitions] [seed] > bench.json\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    srand(seed);
+
+    char directory[] = "/tmp/kernel_benchXXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) != 0)
+    {
+        fprintf(stderr, "Cannot create a temporary directory\n");
+        return EXIT_FAILURE;
+    }
+
+    struct bench_input in;
+    memset(&in, 0, sizeof(in));
+    in.routers = routers;
+    snprintf(in.config_file, sizeof(in.config_file), "%s/config.txt", directory);
+    in.edges = bench_write_config(in.config_file, routers, degree);
+
+    // Kernel output goes to /dev/null, the report to the original stdout
+    fflush(stdout);
+    FILE *json = fdopen(dup(STDOUT_FILENO), "w");
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    struct parsing_output *parsed = data_from_file(in.config_file);
+    in.G = parsed->netgraph;
+    in.as_map = parsed->as_map;
+    in.next_hop = (int *)malloc(sizeof(int) * routers);
+    in.predecessor = (int **)malloc(sizeof(int *) * routers);
+
+    for (int i = 0; i < routers; i++)
+    {
+        struct bellman_results res = bellman_ford(in.G, i);
+        in.predecessor[i] = res.predecessor;
+        free(res.distance);
+    }
+
+    in.rtr = generate_routing_info(in.as_map[0], in.G, in.as_map, parsed->names[0]);
+
+    struct bench_kernel kernels[] = {
+        {"config_from_file", bench_config_from_file, bench_config_edges},
+        {"data_from_file", bench_data_from_file, bench_config_edges},
+        {"init_graph", bench_init_graph, bench_matrix_edges},
+        {"copy_graph", bench_copy_graph, bench_matrix_edges},
+        {"extract_edges", bench_extract_edges, bench_matrix_edges},
+        {"bellman_ford", bench_bellman_ford, bench_relaxed_edges},
+        {"compute_next_hops", bench_next_hops, bench_table_edges},
+        {"describe_router", bench_describe_router, bench_table_edges},
+    };
+    int kernel_count = sizeof(kernels) / sizeof(kernels[0]);
+
+    fprintf(json, "{\n  \"routers\": %i, \"degree\": %i, \"edges\": %i, \"seed\": %i, \"warmup\": %i,\n",
+            routers, degree, in.edges, seed, BENCH_WARMUP);
+    fprintf(json, "  \"kernels\": [\n");
+
+    for (int k = 0; k < kernel_count; k++)
+        bench_kernel(json, &kernels[k], &in, repetitions, k == kernel_count - 1);
+
+    fprintf(json, "  ],\n  \"sink\": %li\n}\n", in.sink);
+    fclose(json);
+
+    for (int i = 0; i < routers; i++)
+    {
+        free(in.predecessor[i]);
+        free(parsed->names[i]);
+    }
+    free(in.predecessor);
+    free(in.next_hop);
+    free(parsed->names);
+    free(parsed->as_map);
+    free_graph(parsed->netgraph);
+    free(parsed);
+
+    char file[320];
+    sprintf(file, "./AS%i.txt", in.rtr->as_number);
+    unlink(file);
+    free_router(in.rtr);
+    unlink(in.config_file);
+    chdir("/");
+    rmdir(directory);
+
+    return EXIT_SUCCESS;
+}
@@ -12,10 +12,25 @@
 #include "mpi.h"
 #include "stdio.h"
 
+#include "arena.h"
+#include "checkpoint.h"
+#include "cluster.h"
 #include "configchain.h"
+#include "contraction.h"
+#include "distvector.h"
 #include "graph.h"
-
+#include "johnson.h"
+#include "largemem.h"
+
+#include "network.h"
+#include "options.h"
+#include "outofcore.h"
+#include "pathquery.h"
+#include "pullbf.h"
 #include "router.h"
+#include "routeserver.h"
+#include "warmstart.h"
+#include "whatif.h"
 #include "stdlib.h"
 #include "string.h"
 
@@ -48,98 +63,134 @@ free()
 
 int main(int argc, char **argv)
 {
-    MPI_Init(&argc, &argv);
+    // Only the main thread talks to MPI, the route server threads never do
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    int router_count;
-    int *as_map = NULL;
-    int *names_length = NULL;
-    char **names = NULL;
-
-    struct graph *netgraph = NULL;
-    
+    struct run_options opts = parse_options(argc, argv);
 
-    if (rank == 0)
+    // Without FUNNELED the MPI library may not tolerate other threads in the process
+    if (provided < MPI_THREAD_FUNNELED && (opts.serve_socket != NULL || opts.pull_threads > 0))
     {
-        struct parsing_output *temp = data_from_file(argv[1]);
+        if (rank == 0)
+            fprintf(stderr, "The MPI library does not support threads (level %i), --serve and --pull need them\n", provided);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
 
-        router_count = temp->node_amount;
-        as_map = temp->as_map;
-        names = temp->names;
+    // Before the graph is allocated, its pages are advised on first use
+    large_memory_configure(opts.huge_pages, opts.numa_placement);
+    if (opts.memory_stats)
+        large_counters_start();
 
-        names_length = malloc(sizeof(int) * router_count);
+    // The out of core mode never builds the cost matrix
+    struct network *net = NULL;
+    if (opts.out_of_core == NULL)
+        net = broadcast_network(opts.config_file, rank);
 
-        for (int i = 0; i < router_count; i++)
-        {
-            names_length[i] = strlen(names[i]);
-        }
+    struct arena *arena = NULL;
+    int status = EXIT_SUCCESS;
 
-        netgraph = temp->netgraph;
+    if (opts.out_of_core != NULL)
+    {
+        // Edges are streamed from a mapped file, only distances stay in memory
+        run_out_of_core(opts.config_file, opts.out_of_core, rank, size);
     }
-
-    // Workery muszą wiedzieć ile jest danych do alokacji
-    // addr, count, size, node_id from, comms
-    MPI_Bcast(&router_count, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-    // Tylko zwykłe workery, nie mają gotowych danych
-    if (as_map == NULL)
+    else if (opts.serve_socket != NULL)
     {
-        as_map = malloc(sizeof(int) * router_count);
-        names_length = malloc(sizeof(int) * router_count);
-        names = malloc(sizeof(char*) * router_count);
+        // Keep all tables resident and answer queries until stopped
+        run_route_server(&opts, &net, rank, size);
     }
-
-    // Prześlij informacje o rozmiarach nazw oraz mapowanie AS
-    MPI_Bcast(as_map, router_count, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(names_length, router_count, MPI_INT, 0, MPI_COMM_WORLD);
-
-    // Przygotowanie miejsca w workerach na nazwy
-    if (rank != 0)
+    else if (opts.distance_vector)
     {
-        for (int i = 0; i < router_count; i++)
-        {
-            names[i] = malloc(sizeof(char) * names_length[i] + 1);
-        }
+        // Routers learn their tables from peers, no process computes whole trees
+        run_distance_vector(net, rank, size);
     }
-
-    // Prześlij nazwy
-    for (int i = 0; i < router_count; i++)
+    else if (opts.ch_build != NULL || (opts.ch_index != NULL && opts.query_file != NULL))
     {
-        MPI_Bcast(names[i], names_length[i] + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
+        // Preprocess once, queries only search upwards in the hierarchy
+        run_contraction(net, opts.ch_build, opts.ch_index, opts.query_file, rank, size);
     }
-    
-    // Prześlij graf
-
-    if (netgraph == NULL)
+    else if (opts.query_file != NULL)
+    {
+        // Only the requested pairs, no routing tables are written
+        run_path_queries(net, opts.query_file, rank, size);
+    }
+    else if (opts.what_if != NULL)
     {
-        netgraph = init_graph(router_count);
+        // Baseline tables once, then only the routers each scenario can change
+        run_what_if(net, opts.what_if, rank, size);
     }
+    else if (opts.pull_threads > 0)
+    {
+        // Threads of a process share each router, nodes pull over incoming edges
+        run_pull(net, rank, size, opts.pull_threads, opts.pull_mode);
+    }
+    else if (opts.johnson)
+    {
+        // One Bellman-Ford for potentials, then Dijkstra from every router
+        if (run_johnson(net, rank, size) != 0)
+            status = EXIT_FAILURE;
+    }
+    else if (opts.warm_start)
+    {
+        // Consecutive routers are peers, each one starts from the previous distances
+        run_warm_start(net, rank, size);
+    }
+    else if (opts.clusters && run_clusters(net, rank, size, opts.cluster_size) == 0)
+    {
+        // Tables inside clusters, routes between them through the boundary overlay
+    }
+    else if (opts.checkpoint_interval >= 0)
+    {
+        // Finished routers are recorded so an interrupted run can resume
+        if (run_checkpointed(net, rank, size, opts.checkpoint_interval, opts.resume) != 0)
+            status = EXIT_FAILURE;
+    }
+    else if (opts.arena_batch > 0)
+    {
+        // Routers and scratch memory come from the arena, released once per batch
+        arena = init_arena(0);
+        struct sssp_workspace *ws = init_sssp_workspace(net->netgraph);
+        int in_batch = 0;
 
-    MPI_Bcast(netgraph->costs, router_count * router_count, MPI_INT, 0, MPI_COMM_WORLD);
-    netgraph->nodes = router_count;
+        for (int i = rank; i < net->router_count; i += size)
+        {
+            struct router * rtr = generate_routing_info_arena(arena, ws, net->as_map[i], net->netgraph, net->as_map, net->names[i]);
+            describe_router(rtr);
+
+            if (++in_batch == opts.arena_batch)
+            {
+                arena_reset(arena);
+                in_batch = 0;
+            }
+        }
 
-    // Each process computes routing information for its assigned nodes
-    for (int i = rank; i < router_count; i += size)
+        free_sssp_workspace(ws);
+    }
+    else
     {
-        struct router * rtr = generate_routing_info(as_map[i], netgraph, as_map, names[i]);
-        describe_router(rtr);
-        free_router(rtr);
+        // Each process computes routing information for its assigned nodes
+        for (int i = rank; i < net->router_count; i += size)
+        {
+            struct router * rtr = generate_routing_info(net->as_map[i], net->netgraph, net->as_map, net->names[i]);
+            describe_router(rtr);
+            free_router(rtr);
+        }
     }
 
-    free_graph(netgraph);
-
-    for (int i = 0; i < router_count; i++)
+    if (opts.memory_stats)
     {
-        free(names[i]);
+        report_memory(arena, rank);
     }
 
-    free(names);
-    free(as_map);
-    free(names_length);
+    free_arena(arena);
+    free_network(net);
 
     MPI_Finalize();
-    return 0;
+    return status;
 }
@@ -0,0 +1,634 @@
+/**
+ * @file mpiprof.c
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief PMPI communication profiler, linked into main with the CMake option MPI_PROFILE
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include "mpi.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "dlfcn.h"
+
+/*
+
+Every MPI call used by the program is wrapped: the wrapper calls the PMPI_
+version and records the call count, the bytes passed to the call (sent, or
+posted for receiving) and the time spent, per call site and communicator.
+The call site is the return address of the wrapper, resolved by dladdr
+(main is linked with exported symbols) to function + offset, so the same
+site has the same name on all processes.
+
+At MPI_Finalize the processes first meet at a barrier (the time spent there is
+the wait for stragglers), then node 0 prints a per process summary and the
+calls aggregated over all processes. Every process also writes its own calls
+to MPIPROF<rank>.txt.
+
+The program calls MPI only from the main thread (MPI_THREAD_FUNNELED), so the
+table is not locked.
+
+*/
+
+#define PROF_SITES 1024
+#define PROF_SITE_LENGTH 80
+#define PROF_NAME_LENGTH 40
+
+enum prof_op {
+    PROF_BCAST, PROF_REDUCE, PROF_ALLREDUCE, PROF_IALLREDUCE, PROF_GATHER, PROF_GATHERV,
+    PROF_ALLGATHER, PROF_ALLGATHERV, PROF_SCATTER, PROF_SCATTERV, PROF_ALLTOALL, PROF_ALLTOALLV,
+    PROF_BARRIER, PROF_SEND, PROF_RECV, PROF_ISEND, PROF_IRECV, PROF_SENDRECV, PROF_PROBE,
+    PROF_IPROBE, PROF_WAIT, PROF_WAITALL, PROF_TEST, PROF_TESTANY, PROF_OPS
+};
+
+static const char *prof_op_names[PROF_OPS] = {
+    "MPI_Bcast", "MPI_Reduce", "MPI_Allreduce", "MPI_Iallreduce", "MPI_Gather", "MPI_Gatherv",
+    "MPI_Allgather", "MPI_Allgatherv", "MPI_Scatter", "MPI_Scatterv", "MPI_Alltoall", "MPI_Alltoallv",
+    "MPI_Barrier", "MPI_Send", "MPI_Recv", "MPI_Isend", "MPI_Irecv", "MPI_Sendrecv", "MPI_Probe",
+    "MPI_Iprobe", "MPI_Wait", "MPI_Waitall", "MPI_Test", "MPI_Testany"};
+
+/**
+ * @brief structure representing the calls of one MPI function from one site on one communicator
+ *
+ * @param used 1 if the slot is taken
+ * @param op called function
+ * @param site return address of the call
+ * @param comm communicator, MPI_COMM_NULL for calls on requests
+ * @param calls number of calls
+ * @param bytes bytes passed to the calls
+ * @param time seconds spent in the calls
+ */
+struct prof_entry {
+    int used;
+    int op;
+    void *site;
+    MPI_Comm comm;
+    long calls;
+    long bytes;
+    double time;
+};
+
+/**
+ * @brief structure representing resolved calls exchanged at MPI_Finalize
+ *
+ * @param op name of the called function
+ * @param site function + offset of the call site
+ * @param comm name of the communicator
+ * @param calls number of calls
+ * @param bytes bytes passed to the calls
+ * @param time seconds spent in the calls
+ */
+struct prof_line {
+    char op[PROF_NAME_LENGTH];
+    char site[PROF_SITE_LENGTH];
+    char comm[PROF_NAME_LENGTH];
+    long calls;
+    long bytes;
+    double time;
+};
+
+static struct prof_entry prof_table[PROF_SITES];
+static double prof_init_time = 0;
+static long prof_dropped = 0;
+
+/**
+ * @brief function recording one MPI call
+ *
+ * @param op called function
+ * @param site return address of the call
+ * @param comm communicator of the call
+ * @param bytes bytes passed to the call
+ * @param time seconds spent in the call
+ */
+static void prof_record(int op, void *site, MPI_Comm comm, long bytes, double time)
+{
+    size_t hash = ((size_t)site * 31 + (size_t)op) * 31 + (size_t)comm;
+    size_t slot = (hash ^ (hash >> 17)) % PROF_SITES;
+
+    for (int probe = 0; probe < PROF_SITES; probe++)
+    {
+        struct prof_entry *e = &prof_table[slot];
+
+        if (!e->used)
+        {
+            e->used = 1;
+            e->op = op;
+            e->site = site;
+            e->comm = comm;
+        }
+
+        if (e->op == op && e->site == site && e->comm == comm)
+        {
+            e->calls++;
+            e->bytes += bytes;
+            e->time += time;
+            return;
+        }
+
+        slot = (slot + 1) % PROF_SITES;
+    }
+
+    prof_dropped++;
+}
+
+/**
+ * @brief function getting the size of count elements of a datatype
+ *
+ * @param count number of elements
+ * @param type datatype of the elements
+ * @return long size in bytes
+ */
+static long prof_bytes(int count, MPI_Datatype type)
+{
+    int size = 0;
+    PMPI_Type_size(type, &size);
+    return (long)count * size;
+}
+
+/**
+ * @brief function getting the total size of a vector of counts
+ *
+ * @param counts counts of all processes of the communicator
+ * @param type datatype of the elements
+ * @param comm communicator
+ * @return long size in bytes
+ */
+static long prof_vector_bytes(const int *counts, MPI_Datatype type, MPI_Comm comm)
+{
+    int processes;
+    long total = 0;
+
+    PMPI_Comm_size(comm, &processes);
+    for (int i = 0; i < processes; i++)
+        total += counts[i];
+
+    return prof_bytes(1, type) * total;
+}
+
+/**
+ * @brief function getting the size of the communicator
+ *
+ * @param comm communicator
+ * @return int number of processes
+ */
+static int prof_comm_size(MPI_Comm comm)
+{
+    int processes;
+    PMPI_Comm_size(comm, &processes);
+    return processes;
+}
+
+#define PROF_BEGIN double prof_start = PMPI_Wtime();
+#define PROF_END(op, comm, bytes) prof_record(op, __builtin_return_address(0), comm, bytes, PMPI_Wtime() - prof_start);
+
+int MPI_Init(int *argc, char ***argv)
+{
+    int result = PMPI_Init(argc, argv);
+    prof_init_time = PMPI_Wtime();
+    return result;
+}
+
+int MPI_Init_thread(int *argc, char ***argv, int required, int *provided)
+{
+    int result = PMPI_Init_thread(argc, argv, required, provided);
+    prof_init_time = PMPI_Wtime();
+    return result;
+}
+
+int MPI_Bcast(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Bcast(buffer, count, datatype, root, comm);
+    PROF_END(PROF_BCAST, comm, prof_bytes(count, datatype))
+    return result;
+}
+
+int MPI_Reduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+    PROF_END(PROF_REDUCE, comm, prof_bytes(count, datatype))
+    return result;
+}
+
+int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+    PROF_END(PROF_ALLREDUCE, comm, prof_bytes(count, datatype))
+    return result;
+}
+
+int MPI_Iallreduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm, MPI_Request *request)
+{
+    PROF_BEGIN
+    int result = PMPI_Iallreduce(sendbuf, recvbuf, count, datatype, op, comm, request);
+    PROF_END(PROF_IALLREDUCE, comm, prof_bytes(count, datatype))
+    return result;
+}
+
+int MPI_Gather(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount,
+               MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    PROF_END(PROF_GATHER, comm, prof_bytes(sendcount, sendtype))
+    return result;
+}
+
+int MPI_Gatherv(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, const int recvcounts[],
+                const int displs[], MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+    PROF_END(PROF_GATHERV, comm, prof_bytes(sendcount, sendtype))
+    return result;
+}
+
+int MPI_Allgather(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                  MPI_Datatype recvtype, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    PROF_END(PROF_ALLGATHER, comm, prof_bytes(sendcount, sendtype))
+    return result;
+}
+
+int MPI_Allgatherv(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, const int recvcounts[],
+                   const int displs[], MPI_Datatype recvtype, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
+    PROF_END(PROF_ALLGATHERV, comm, prof_bytes(sendcount, sendtype))
+    return result;
+}
+
+int MPI_Scatter(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Scatter(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    PROF_END(PROF_SCATTER, comm, prof_bytes(recvcount, recvtype))
+    return result;
+}
+
+int MPI_Scatterv(const void *sendbuf, const int sendcounts[], const int displs[], MPI_Datatype sendtype, void *recvbuf,
+                 int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    PROF_END(PROF_SCATTERV, comm, prof_bytes(recvcount, recvtype))
+    return result;
+}
+
+int MPI_Alltoall(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                 MPI_Datatype recvtype, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    PROF_END(PROF_ALLTOALL, comm, prof_bytes(sendcount, sendtype) * prof_comm_size(comm))
+    return result;
+}
+
+int MPI_Alltoallv(const void *sendbuf, const int sendcounts[], const int sdispls[], MPI_Datatype sendtype,
+                  void *recvbuf, const int recvcounts[], const int rdispls[], MPI_Datatype recvtype, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+    PROF_END(PROF_ALLTOALLV, comm, prof_vector_bytes(sendcounts, sendtype, comm))
+    return result;
+}
+
+int MPI_Barrier(MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Barrier(comm);
+    PROF_END(PROF_BARRIER, comm, 0)
+    return result;
+}
+
+int MPI_Send(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm)
+{
+    PROF_BEGIN
+    int result = PMPI_Send(buf, count, datatype, dest, tag, comm);
+    PROF_END(PROF_SEND, comm, prof_bytes(count, datatype))
+    return result;
+}
+
+int MPI_Recv(void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status *status)
+{
+    PROF_BEGIN
+    int result = PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+    PROF_END(PROF_RECV, comm, prof_bytes(count, datatype))
+    return result;
+}
+
+int MPI_Isend(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, MPI_Request *request)
+{
+    PROF_BEGIN
+    int result = PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+    PROF_END(PROF_ISEND, comm, prof_bytes(count, datatype))
+    return result;
+}
+
+int MPI_Irecv(void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Request *request)
+{
+    PROF_BEGIN
+    int result = PMPI_Irecv(buf, count, datatype, source, tag, comm, request);
+    PROF_END(PROF_IRECV, comm, prof_bytes(count, datatype))
+    return result;
+}
+
+int MPI_Sendrecv(const void *sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag, void *recvbuf,
+                 int recvcount, MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm, MPI_Status *status)
+{
+    PROF_BEGIN
+    int result = PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag, recvbuf, recvcount, recvtype, source, recvtag, comm, status);
+    PROF_END(PROF_SENDRECV, comm, prof_bytes(sendcount, sendtype))
+    return result;
+}
+
+int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status *status)
+{
+    PROF_BEGIN
+    int result = PMPI_Probe(source, tag, comm, status);
+    PROF_END(PROF_PROBE, comm, 0)
+    return result;
+}
+
+int MPI_Iprobe(int source, int tag, MPI_Comm comm, int *flag, MPI_Status *status)
+{
+    PROF_BEGIN
+    int result = PMPI_Iprobe(source, tag, comm, flag, status);
+    PROF_END(PROF_IPROBE, comm, 0)
+    return result;
+}
+
+int MPI_Wait(MPI_Request *request, MPI_Status *status)
+{
+    PROF_BEGIN
+    int result = PMPI_Wait(request, status);
+    PROF_END(PROF_WAIT, MPI_COMM_NULL, 0)
+    return result;
+}
+
+int MPI_Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_statuses[])
+{
+    PROF_BEGIN
+    int result = PMPI_Waitall(count, array_of_requests, array_of_statuses);
+    PROF_END(PROF_WAITALL, MPI_COMM_NULL, 0)
+    return result;
+}
+
+int MPI_Test(MPI_Request *request, int *flag, MPI_Status *status)
+{
+    PROF_BEGIN
+    int result = PMPI_Test(request, flag, status);
+    PROF_END(PROF_TEST, MPI_COMM_NULL, 0)
+    return result;
+}
+
+int MPI_Testany(int count, MPI_Request array_of_requests[], int *index, int *flag, MPI_Status *status)
+{
+    PROF_BEGIN
+    int result = PMPI_Testany(count, array_of_requests, index, flag, status);
+    PROF_END(PROF_TESTANY, MPI_COMM_NULL, 0)
+    return result;
+}
+
+/**
+ * @brief function resolving the recorded calls to names comparable between processes
+ *
+ * @param count pointer to the number of resolved calls
+ * @return struct prof_line* resolved calls, sorted by time
+ */
+static struct prof_line *prof_resolve(int *count)
+{
+    struct prof_line *lines = (struct prof_line *)calloc(PROF_SITES, sizeof(struct prof_line));
+    int n = 0;
+
+    for (int i = 0; i < PROF_SITES; i++)
+    {
+        struct prof_entry *e = &prof_table[i];
+        if (!e->used)
+            continue;
+
+        struct prof_line *l = &lines[n++];
+        Dl_info info;
+
+        snprintf(l->op, PROF_NAME_LENGTH, "%s", prof_op_names[e->op]);
+
+        if (dladdr(e->site, &info) && info.dli_sname != NULL)
+            snprintf(l->site, PROF_SITE_LENGTH, "%s+0x%lx", info.dli_sname, (unsigned long)((char *)e->site - (char *)info.dli_saddr));
+        else if (dladdr(e->site, &info) && info.dli_fname != NULL)
+            snprintf(l->site, PROF_SITE_LENGTH, "%s+0x%lx", strrchr(info.dli_fname, '/') ? strrchr(info.dli_fname, '/') + 1 : info.dli_fname,
+                     (unsigned long)((char *)e->site - (char *)info.dli_fbase));
+        else
+            snprintf(l->site, PROF_SITE_LENGTH, "%p", e->site);
+
+        int length = 0;
+        if (e->comm == MPI_COMM_NULL)
+            snprintf(l->comm, PROF_NAME_LENGTH, "-");
+        else
+            PMPI_Comm_get_name(e->comm, l->comm, &length);
+
+        if (e->comm != MPI_COMM_NULL && length == 0)
+            snprintf(l->comm, PROF_NAME_LENGTH, "comm %p", (void *)e->comm);
+
+        l->calls = e->calls;
+        l->bytes = e->bytes;
+        l->time = e->time;
+    }
+
+    // Sort by time, slowest first
+    for (int i = 1; i < n; i++)
+    {
+        struct prof_line key = lines[i];
+        int j = i - 1;
+
+        while (j >= 0 && lines[j].time < key.time)
+        {
+            lines[j + 1] = lines[j];
+            j--;
+        }
+
+        lines[j + 1] = key;
+    }
+
+    *count = n;
+    return lines;
+}
+
+/**
+ * @brief function writing the calls of one process to MPIPROF<rank>.txt
+ *
+ * @param rank rank of the process
+ * @param lines resolved calls
+ * @param count number of resolved calls
+ */
+static void prof_write_rank(int rank, struct prof_line *lines, int count)
+{
+    char file[64];
+    sprintf(file, "./MPIPROF%i.txt", rank);
+
+    FILE *fp = fopen(file, "w");
+    if (fp == NULL)
+        return;
+
+    fprintf(fp, "%-16s %-40s %-16s %10s %14s %12s\n", "CALL", "SITE", "COMM", "CALLS", "BYTES", "SECONDS");
+
+    for (int i = 0; i < count; i++)
+    {
+        fprintf(fp, "%-16s %-40s %-16s %10li %14li %12.6f\n",
+                lines[i].op, lines[i].site, lines[i].comm, lines[i].calls, lines[i].bytes, lines[i].time);
+    }
+
+    if (prof_dropped > 0)
+        fprintf(fp, "%li calls not recorded, table full\n", prof_dropped);
+
+    fclose(fp);
+}
+
+int MPI_Finalize(void)
+{
+    int rank, size;
+    PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    PMPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Time until the last process is done is the cost of load imbalance
+    double arrived = PMPI_Wtime();
+    PMPI_Barrier(MPI_COMM_WORLD);
+    double wait = PMPI_Wtime() - arrived;
+
+    int count;
+    struct prof_line *lines = prof_resolve(&count);
+    prof_write_rank(rank, lines, count);
+
+    double mpi_time = 0;
+    long calls = 0;
+    long bytes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        mpi_time += lines[i].time;
+        calls += lines[i].calls;
+        bytes += lines[i].bytes;
+    }
+
+    double wall = arrived - prof_init_time;
+    double summary[6] = {wall, mpi_time, wall - mpi_time, wait, (double)calls, (double)bytes};
+    double *summaries = NULL;
+    int *counts = NULL;
+    int *displs = NULL;
+    struct prof_line *all = NULL;
+
+    if (rank == 0)
+    {
+        summaries = (double *)malloc(sizeof(double) * 6 * size);
+        counts = (int *)malloc(sizeof(int) * size);
+        displs = (int *)malloc(sizeof(int) * size);
+    }
+
+    int line_bytes = count * (int)sizeof(struct prof_line);
+    PMPI_Gather(summary, 6, MPI_DOUBLE, summaries, 6, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    PMPI_Gather(&line_bytes, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int total = 0;
+    if (rank == 0)
+    {
+        for (int r = 0; r < size; r++)
+        {
+            displs[r] = total;
+            total += counts[r];
+        }
+        all = (struct prof_line *)malloc(total + 1);
+    }
+
+    PMPI_Gatherv(lines, line_bytes, MPI_BYTE, all, counts, displs, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        double compute_max = 0, compute_sum = 0, wait_sum = 0, wall_sum = 0;
+
+        printf("MPI profile: %4s %10s %10s %10s %10s %10s %14s\n", "RANK", "WALL", "MPI", "COMPUTE", "WAIT", "CALLS", "BYTES");
+        for (int r = 0; r < size; r++)
+        {
+            double *s = summaries + 6 * r;
+            printf("MPI profile: %4i %10.4f %10.4f %10.4f %10.4f %10.0f %14.0f\n", r, s[0], s[1], s[2], s[3], s[4], s[5]);
+
+            compute_max = s[2] > compute_max ? s[2] : compute_max;
+            compute_sum += s[2];
+            wait_sum += s[3];
+            wall_sum += s[0];
+        }
+
+        double compute_avg = compute_sum / size;
+        printf("MPI profile: compute imbalance %.1f%% (max / average - 1), %.1f%% of the run spent waiting in MPI_Finalize\n",
+               compute_avg > 0 ? 100.0 * (compute_max / compute_avg - 1) : 0.0,
+               wall_sum + wait_sum > 0 ? 100.0 * wait_sum / (wall_sum + wait_sum) : 0.0);
+
+        // Merge the calls of all processes by name
+        int n = total / (int)sizeof(struct prof_line);
+        struct prof_line *merged = (struct prof_line *)calloc(n + 1, sizeof(struct prof_line));
+        double *slowest = (double *)calloc(n + 1, sizeof(double));
+        int m = 0;
+
+        for (int i = 0; i < n; i++)
+        {
+            int j = 0;
+            while (j < m && (strcmp(merged[j].op, all[i].op) || strcmp(merged[j].site, all[i].site) || strcmp(merged[j].comm, all[i].comm)))
+                j++;
+
+            if (j == m)
+            {
+                merged[m] = all[i];
+                merged[m].calls = 0;
+                merged[m].bytes = 0;
+                merged[m].time = 0;
+                m++;
+            }
+
+            merged[j].calls += all[i].calls;
+            merged[j].bytes += all[i].bytes;
+            merged[j].time += all[i].time;
+            if (all[i].time > slowest[j])
+                slowest[j] = all[i].time;
+        }
+
+        printf("MPI profile: %-16s %-40s %-16s %10s %14s %10s %10s %9s\n",
+               "CALL", "SITE", "COMM", "CALLS", "BYTES", "AVG S", "MAX S", "MAX/AVG");
+
+        for (int printed = 0; printed < m; printed++)
+        {
+            int best = -1;
+            for (int j = 0; j < m; j++)
+            {
+                if (merged[j].calls >= 0 && (best < 0 || merged[j].time > merged[best].time))
+                    best = j;
+            }
+
+            double avg = merged[best].time / size;
+            printf("MPI profile: %-16s %-40s %-16s %10li %14li %10.6f %10.6f %9.2f\n",
+                   merged[best].op, merged[best].site, merged[best].comm, merged[best].calls, merged[best].bytes,
+                   avg, slowest[best], avg > 0 ? slowest[best] / avg : 1.0);
+
+            merged[best].calls = -1;
+        }
+
+        free(merged);
+        free(slowest);
+        free(summaries);
+        free(counts);
+        free(displs);
+        free(all);
+    }
+
+    free(lines);
+
+    return PMPI_Finalize();
+}
@@ -0,0 +1,90 @@
+/**
+ * @file pull_check.c
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief check of the pull engine against bellman_ford
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+
+#include "bellford.h"
+#include "graph.h"
+#include "pullbf.h"
+
+/*
+
+Usage: pull_check <routers> <threads> [seed]
+
+Builds a random graph (a ring plus random links, most of them to the last
+routers, so every router is reachable and the thread bounds crowd at the end)
+and compares the distances of the pull engine in both modes with
+bellman_ford() from every router. With more threads than words of the
+frontier (routers / 32) some threads get no routers at all, which is the case
+the thread bounds have to handle. Exits with a failure status if any distance
+differs.
+
+*/
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || atoi(argv[1]) < 2 || atoi(argv[2]) < 1)
+    {
+        fprintf(stderr, "Usage: %s <routers> <threads> [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int nodes = atoi(argv[1]);
+    int threads = atoi(argv[2]);
+    srand(argc > 3 ? atoi(argv[3]) : 1);
+
+    struct graph *G = init_graph(nodes);
+    for (int v = 0; v < nodes; v++)
+    {
+        set_edge(G, v, (v + 1) % nodes, 1 + rand() % 10);
+
+        for (int k = 0; k < 3; k++)
+        {
+            // Hubs at the end, like configurations read in reverse, push the bounds there
+            int peer = nodes - 1 - rand() % (1 + rand() % nodes);
+            if (peer != v)
+                set_edge(G, v, peer, 1 + rand() % 20);
+        }
+    }
+
+    int mismatches = 0;
+
+    for (int mode = PULL_JACOBI; mode <= PULL_GAUSS_SEIDEL; mode++)
+    {
+        struct pull_engine *E = init_pull_engine(G, threads, mode);
+
+        for (int source = 0; source < nodes; source++)
+        {
+            struct bellman_results expected = bellman_ford(G, source);
+            struct bellman_results got = pull_shortest_paths(E, source);
+
+            for (int v = 0; v < nodes; v++)
+            {
+                if (got.distance[v] != expected.distance[v] && mismatches++ < 10)
+                    printf("%s, %i threads: %i -> %i is %i instead of %i\n", mode == PULL_JACOBI ? "Jacobi" : "Gauss-Seidel",
+                           threads, source, v, got.distance[v], expected.distance[v]);
+            }
+
+            free(expected.distance);
+            free(expected.predecessor);
+            free(got.distance);
+            free(got.predecessor);
+        }
+
+        free_pull_engine(E);
+    }
+
+    free_graph(G);
+
+    printf("%i routers, %i threads: %i mismatches\n", nodes, threads, mismatches);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,254 @@
+/**
+ * @file route_loadgen.c
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief load generator for the route query server
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "pthread.h"
+#include "unistd.h"
+#include "sys/socket.h"
+#include "sys/un.h"
+
+#include "routeproto.h"
+
+/**
+ * @brief structure representing a single client connection
+ *
+ * @param socket_path path of the server socket
+ * @param as_numbers AS numbers known to the server
+ * @param as_count number of known AS numbers
+ * @param batches number of batches to send
+ * @param batch_size number of queries in every batch
+ * @param seed random seed of this client
+ * @param latencies measured latency of every batch in nanoseconds
+ * @param unknown number of answers without a route
+ */
+struct loadgen_client {
+    const char *socket_path;
+    const int32_t *as_numbers;
+    int as_count;
+    int batches;
+    int batch_size;
+    unsigned int seed;
+    long *latencies;
+    long unknown;
+};
+
+/**
+ * @brief function connecting to the server
+ *
+ * @param path path of the server socket
+ * @return int connected descriptor, -1 on error
+ */
+int loadgen_connect(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief function returning the monotonic time in nanoseconds
+ *
+ * @return long current time
+ */
+long loadgen_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/**
+ * @brief function of a client thread, sends random batches and measures their latency
+ *
+ * @param arg pointer to the struct loadgen_client
+ * @return void* NULL on success, non NULL on error
+ */
+void *loadgen_run(void *arg)
+{
+    struct loadgen_client *client = (struct loadgen_client *)arg;
+
+    int fd = loadgen_connect(client->socket_path);
+    if (fd < 0)
+        return arg;
+
+    struct route_query *queries = malloc(sizeof(struct route_query) * client->batch_size);
+    struct route_answer *answers = malloc(sizeof(struct route_answer) * client->batch_size);
+    struct route_header header;
+    void *result = NULL;
+
+    for (int b = 0; b < client->batches; b++)
+    {
+        for (int i = 0; i < client->batch_size; i++)
+        {
+            queries[i].from_as = client->as_numbers[rand_r(&client->seed) % client->as_count];
+            queries[i].to_as = client->as_numbers[rand_r(&client->seed) % client->as_count];
+        }
+
+        header.magic = ROUTE_MAGIC;
+        header.op = ROUTE_OP_QUERY;
+        header.count = client->batch_size;
+
+        long start = loadgen_now();
+
+        if (route_write_full(fd, &header, sizeof(header)) != 0 ||
+            route_write_full(fd, queries, sizeof(struct route_query) * client->batch_size) != 0 ||
+            route_read_full(fd, &header, sizeof(header)) != 0 ||
+            route_read_full(fd, answers, sizeof(struct route_answer) * client->batch_size) != 0)
+        {
+            result = arg;
+            break;
+        }
+
+        client->latencies[b] = loadgen_now() - start;
+
+        for (int i = 0; i < client->batch_size; i++)
+        {
+            if (answers[i].via_as < 0)
+                client->unknown++;
+        }
+    }
+
+    free(queries);
+    free(answers);
+    close(fd);
+    return result;
+}
+
+/**
+ * @brief comparison function for sorting latencies
+ */
+int loadgen_compare(const void *a, const void *b)
+{
+    long x = *(const long *)a;
+    long y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <socket> [clients] [batches per client] [batch size]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *path = argv[1];
+    int clients = argc > 2 ? atoi(argv[2]) : 4;
+    int batches = argc > 3 ? atoi(argv[3]) : 10000;
+    int batch_size = argc > 4 ? atoi(argv[4]) : 64;
+
+    if (clients < 1 || batches < 1 || batch_size < 1 || batch_size > ROUTE_MAX_BATCH)
+    {
+        fprintf(stderr, "Invalid load parameters\n");
+        return EXIT_FAILURE;
+    }
+
+    // Ask the server which routers exist
+    int fd = loadgen_connect(path);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Cannot connect to %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    struct route_header header;
+    header.magic = ROUTE_MAGIC;
+    header.op = ROUTE_OP_INFO;
+    header.count = 0;
+
+    if (route_write_full(fd, &header, sizeof(header)) != 0 || route_read_full(fd, &header, sizeof(header)) != 0 || header.count == 0)
+    {
+        fprintf(stderr, "Server did not describe the network\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    int32_t *as_numbers = malloc(sizeof(int32_t) * header.count);
+    if (route_read_full(fd, as_numbers, sizeof(int32_t) * header.count) != 0)
+    {
+        fprintf(stderr, "Server did not describe the network\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    struct loadgen_client *all = calloc(clients, sizeof(struct loadgen_client));
+    pthread_t *threads = malloc(sizeof(pthread_t) * clients);
+    long *latencies = malloc(sizeof(long) * clients * batches);
+
+    long start = loadgen_now();
+
+    for (int c = 0; c < clients; c++)
+    {
+        all[c].socket_path = path;
+        all[c].as_numbers = as_numbers;
+        all[c].as_count = header.count;
+        all[c].batches = batches;
+        all[c].batch_size = batch_size;
+        all[c].seed = 12345u + c;
+        all[c].latencies = latencies + (long)c * batches;
+        pthread_create(&threads[c], NULL, loadgen_run, &all[c]);
+    }
+
+    int failed = 0;
+    long unknown = 0;
+    for (int c = 0; c < clients; c++)
+    {
+        void *result;
+        pthread_join(threads[c], &result);
+        if (result != NULL)
+            failed = 1;
+        unknown += all[c].unknown;
+    }
+
+    double elapsed = (loadgen_now() - start) / 1e9;
+
+    if (failed)
+    {
+        fprintf(stderr, "Connection to the server failed\n");
+        return EXIT_FAILURE;
+    }
+
+    long samples = (long)clients * batches;
+    qsort(latencies, samples, sizeof(long), loadgen_compare);
+
+    printf("Routers:          %u\n", header.count);
+    printf("Clients:          %i\n", clients);
+    printf("Batches:          %li of %i queries\n", samples, batch_size);
+    printf("Unknown routes:   %li\n", unknown);
+    printf("Throughput:       %.0f queries/s\n", samples * (double)batch_size / elapsed);
+    printf("Batch latency p50 %.1f us\n", latencies[samples / 2] / 1e3);
+    printf("Batch latency p99 %.1f us\n", latencies[(samples * 99) / 100] / 1e3);
+    printf("Batch latency max %.1f us\n", latencies[samples - 1] / 1e3);
+
+    free(as_numbers);
+    free(all);
+    free(threads);
+    free(latencies);
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file topology_gen.c
+ * @author Jakub Kawka, Marcin Kiżewski
+ * @brief generator of Internet-like routing configurations and query files
+ * @version 0.1
+ * @date 2025-05-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+/*
+
+Usage: topology_gen <routers> [seed] [query file] [queries] > config.txt
+
+A fully meshed core of tier 1 routers, every further router buys transit from
+1 to 3 earlier routers picked proportionally to their degree (preferential
+attachment, so a few hubs get most customers) and some routers peer with a
+router close to them in the arrival order. Links are bidirectional, the two
+directions may have different costs. The optional query file gets random
+pairs of AS numbers in the format of --query.
+
+*/
+
+#define GEN_AS_BASE 1000
+
+/**
+ * @brief structure representing the generated links of a router
+ *
+ * @param count number of peers
+ * @param capacity allocated number of peers
+ * @param peer peer router indices
+ * @param cost cost of the link to every peer
+ */
+struct gen_router {
+    int count;
+    int capacity;
+    int *peer;
+    int *cost;
+};
+
+/**
+ * @brief function checking if two routers are linked
+ *
+ * @param R array of routers
+ * @param a first router
+ * @param b second router
+ * @return int 1 if linked
+ */
+int gen_linked(struct gen_router *R, int a, int b)
+{
+    for (int k = 0; k < R[a].count; k++)
+    {
+        if (R[a].peer[k] == b)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief function adding a directed link
+ *
+ * @param R array of routers
+ * @param a router the link starts at
+ * @param b router the link goes to
+ * @param cost cost of the link
+ */
+void gen_add(struct gen_router *R, int a, int b, int cost)
+{
+    if (R[a].count == R[a].capacity)
+    {
+        R[a].capacity = R[a].capacity ? 2 * R[a].capacity : 4;
+        R[a].peer = (int *)realloc(R[a].peer, sizeof(int) * R[a].capacity);
+        R[a].cost = (int *)realloc(R[a].cost, sizeof(int) * R[a].capacity);
+    }
+
+    R[a].peer[R[a].count] = b;
+    R[a].cost[R[a].count] = cost;
+    R[a].count++;
+}
+
+/**
+ * @brief function linking two routers in both directions
+ *
+ * @param R array of routers
+ * @param ends endpoints of all links so far, for preferential attachment
+ * @param end_count pointer to the number of endpoints
+ * @param a first router
+ * @param b second router
+ * @param low lowest cost
+ * @param high highest cost
+ * @return int 1 if a new link was added
+ */
+int gen_link(struct gen_router *R, int *ends, long *end_count, int a, int b, int low, int high)
+{
+    if (a == b || gen_linked(R, a, b))
+        return 0;
+
+    int cost = low + rand() % (high - low + 1);
+
+    // Mostly symmetric, some links are cheaper in one direction
+    gen_add(R, a, b, cost);
+    gen_add(R, b, a, rand() % 4 == 0 ? low + rand() % (high - low + 1) : cost);
+
+    ends[(*end_count)++] = a;
+    ends[(*end_count)++] = b;
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || atoi(argv[1]) < 2)
+    {
+        fprintf(stderr, "Usage: %s <routers> [seed] [query file] [queries] > config.txt\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int routers = atoi(argv[1]);
+    srand(argc > 2 ? atoi(argv[2]) : 1);
+
+    int core = routers / 200 < 4 ? 4 : routers / 200;
+    if (core > routers)
+        core = routers;
+
+    struct gen_router *R = (struct gen_router *)calloc(routers, sizeof(struct gen_router));
+    int *ends = (int *)malloc(sizeof(int) * ((long)core * core + 10L * routers));
+    long end_count = 0;
+
+    for (int a = 0; a < core; a++)
+    {
+        for (int b = a + 1; b < core; b++)
+            gen_link(R, ends, &end_count, a, b, 1, 3);
+    }
+
+    for (int v = core; v < routers; v++)
+    {
+        int providers = 1 + rand() % 3;
+
+        for (int p = 0; p < providers; p++)
+        {
+            // Retry a few times if the provider is already linked
+            for (int attempt = 0; attempt < 8; attempt++)
+            {
+                int provider = ends[rand() % end_count];
+                if (gen_link(R, ends, &end_count, v, provider, 1, 10))
+                    break;
+            }
+        }
+
+        if (rand() % 10 < 3)
+        {
+            int near = v - 1 - rand() % (v < 50 ? v : 50);
+            gen_link(R, ends, &end_count, v, near, 5, 15);
+        }
+    }
+
+    for (int v = 0; v < routers; v++)
+    {
+        printf("ROUTER as%i %i\n", v, GEN_AS_BASE + v);
+        for (int k = 0; k < R[v].count; k++)
+            printf("PEER %i %i\n", GEN_AS_BASE + R[v].peer[k], R[v].cost[k]);
+        printf("\n");
+    }
+
+    if (argc > 3)
+    {
+        FILE *fp = fopen(argv[3], "w");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Cannot create %s\n", argv[3]);
+            return EXIT_FAILURE;
+        }
+
+        int queries = argc > 4 ? atoi(argv[4]) : 1000;
+        for (int q = 0; q < queries; q++)
+            fprintf(fp, "%i %i\n", GEN_AS_BASE + rand() % routers, GEN_AS_BASE + rand() % routers);
+
+        fclose(fp);
+    }
+
+    for (int v = 0; v < routers; v++)
+    {
+        free(R[v].peer);
+        free(R[v].cost);
+    }
+    free(R);
+    free(ends);
+
+    return EXIT_SUCCESS;
+}